@@ -0,0 +1,54 @@
+// cmd.h - BIOS monitor command registry
+#ifndef __BIOS_CMD_H__
+#define __BIOS_CMD_H__
+
+#include <stdint.h>
+
+// Commands are registered with BIOS_CMD() from any source file. Each entry
+// is placed in its own .bios_cmds.<name> section; the linker script sorts
+// them by name into one table between __bios_cmds_start/__bios_cmds_end.
+//
+// The Makefile collects the names from the BIOS_CMD() lines in src/*.c and
+// tools/gen_cmd_hash.c searches for a seed that makes cmd_hash() collision
+// free over them, emitting build/cmd_hash.h (slot -> table index). Dispatch
+// is then one hash, one table lookup and one strcmp, however many commands
+// there are. BIOS_CMD must start the line for the name scan to see it.
+
+#define CMD_MAX_ARGS    8       // Including the command name itself
+
+struct bios_cmd {
+    const char* name;
+    const char* usage;          // Argument synopsis shown by help, "" if none
+    const char* help;
+    int min_args;               // Not counting the command name
+    int max_args;
+    // argv[0] is the command name; return nonzero to print the usage line
+    int (*handler)(int argc, char** argv);
+};
+
+#define BIOS_CMD(_name, _usage, _help, _min, _max, _handler)                  \
+    static const struct bios_cmd __bios_cmd_##_name                           \
+    __attribute__((used, section(".bios_cmds." #_name), aligned(8))) = {      \
+        .name = #_name,                                                       \
+        .usage = _usage,                                                      \
+        .help = _help,                                                        \
+        .min_args = _min,                                                     \
+        .max_args = _max,                                                     \
+        .handler = _handler,                                                  \
+    }
+
+// FNV-1a mixed with a seed; shared with the build-time generator
+static inline uint32_t cmd_hash(const char* s, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+// Split the line in place and run the matching command
+void cmd_dispatch(char* line);
+
+#endif /* __BIOS_CMD_H__ */
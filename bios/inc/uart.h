@@ -8,12 +8,20 @@
 // Configuration
 #define UART_BUFFER_SIZE    256     // Input buffer size
 #define UART_DEFAULT_BAUD   115200  // Default baud rate
+#define UART_PRINTF_BUFFER_SIZE 256 // Longest single uart_printf message
+#define UART_RX_RING_SIZE   256     // ISR -> main loop receive ring, power of two
+#define UART_TX_RING_SIZE   1024    // Main loop -> THRE interrupt transmit ring, power of two
 
 // UART statistics structure
 typedef struct {
     unsigned int bytes_received;
     unsigned int bytes_transmitted;
     unsigned int lines_processed;
+    unsigned int interrupts;        // UART interrupts taken (one per PLIC claim)
+    unsigned int rx_interrupts;     // ... that drained the RX FIFO
+    unsigned int rx_timeouts;       // ... raised by the character timeout
+    unsigned int tx_interrupts;     // ... that refilled the TX FIFO
+    unsigned int level_changes;     // RX trigger level adjustments
 } uart_stats_t;
 
 // Function prototypes
@@ -21,19 +29,29 @@ typedef struct {
 // Initialization
 void uart_init(unsigned int baud_rate);
 
-// Basic I/O functions
+// Basic I/O functions; output is queued and sent by the THRE interrupt
 void uart_putc(char c);
+void uart_write(const char* buf, unsigned int len);   // Masks interrupts once per call
 void uart_puts(const char* str);
 void uart_println(const char* str);
+// Block until all queued output has left the UART
+void uart_flush(void);
+// Unexpected trap: print by polling and stop (called from assembly)
+void bios_panic(unsigned long mcause, unsigned long mepc, unsigned long mtval) __attribute__((noreturn));
 
-// Formatted output
-void uart_printf(const char* format, ...);
+// Formatted output (see common/printf.h for supported conversions)
+void uart_printf(const char* format, ...) __attribute__((format(printf, 1, 2)));
 void uart_print_int(int num);
 void uart_print_hex(unsigned int num);
 
-// Interrupt handler (called from assembly)
+// Interrupt handler (called from assembly); only drains the RX FIFO into a ring
 void uart_interrupt_handler(void);
 
+// Main loop (called from assembly): nonzero if uart_process_input has work,
+// and the line editing/command dispatch itself
+int uart_rx_pending(void);
+void uart_process_input(void);
+
 // Statistics
 uart_stats_t uart_get_stats(void);
 
@@ -43,10 +61,4 @@ int strcmp(const char* s1, const char* s2);
 // System functions (implemented in assembly)
 extern void system_reboot(void);
 
-// Internal functions (static in C file)
-static void handle_receive_interrupt(void);
-static void handle_line_status_interrupt(void);
-static void process_command(const char* cmd);
-static void handle_backspace(void);
-
 #endif /* __BIOS_UART_H__ */
\ No newline at end of file
@@ -0,0 +1,112 @@
+// cmd.c - BIOS monitor command dispatch
+#include "cmd.h"
+#include "cmd_hash.h"
+#include "uart.h"
+
+// Provided by the linker script, sorted by command name
+extern const struct bios_cmd __bios_cmds_start[];
+extern const struct bios_cmd __bios_cmds_end[];
+
+// 1 = the linked table matches the generated hash, -1 = it does not (stale
+// build/cmd_hash.h), 0 = not checked yet. A mismatch falls back to a
+// linear scan so the monitor stays usable.
+static int table_checked;
+
+static int cmd_table_check(void) {
+    int n = __bios_cmds_end - __bios_cmds_start;
+
+    if (n != CMD_COUNT) {
+        return -1;
+    }
+    for (uint32_t s = 0; s < (1u << CMD_HASH_BITS); s++) {
+        int idx = cmd_hash_slots[s];
+        if (idx < 0) {
+            continue;
+        }
+        uint32_t h = cmd_hash(__bios_cmds_start[idx].name, CMD_HASH_SEED);
+        if ((h & ((1u << CMD_HASH_BITS) - 1)) != s) {
+            return -1;
+        }
+    }
+    return 1;
+}
+
+static const struct bios_cmd* cmd_lookup(const char* name) {
+    if (table_checked == 0) {
+        table_checked = cmd_table_check();
+        if (table_checked < 0) {
+            uart_println("cmd: command table does not match cmd_hash.h, using linear lookup");
+        }
+    }
+
+    if (table_checked > 0) {
+        uint32_t s = cmd_hash(name, CMD_HASH_SEED) & ((1u << CMD_HASH_BITS) - 1);
+        int idx = cmd_hash_slots[s];
+        if (idx >= 0 && strcmp(__bios_cmds_start[idx].name, name) == 0) {
+            return &__bios_cmds_start[idx];
+        }
+        return 0;
+    }
+
+    for (const struct bios_cmd* c = __bios_cmds_start; c < __bios_cmds_end; c++) {
+        if (strcmp(c->name, name) == 0) {
+            return c;
+        }
+    }
+    return 0;
+}
+
+static void print_usage(const struct bios_cmd* c) {
+    uart_printf("Usage: %s %s\r\n", c->name, c->usage);
+}
+
+void cmd_dispatch(char* line) {
+    char* argv[CMD_MAX_ARGS + 1];
+    int argc = 0;
+
+    // Split on spaces; the line editor only lets printable characters through
+    while (*line) {
+        while (*line == ' ') {
+            *line++ = '\0';
+        }
+        if (*line == '\0') {
+            break;
+        }
+        if (argc == CMD_MAX_ARGS) {
+            uart_printf("Too many arguments (max %d)\r\n", CMD_MAX_ARGS - 1);
+            return;
+        }
+        argv[argc++] = line;
+        while (*line && *line != ' ') {
+            line++;
+        }
+    }
+    if (argc == 0) {
+        return; // Empty command
+    }
+    argv[argc] = 0;
+
+    const struct bios_cmd* c = cmd_lookup(argv[0]);
+    if (c == 0) {
+        uart_printf("Unknown command: %s\r\n", argv[0]);
+        uart_println("Type 'help' for available commands.");
+        return;
+    }
+    if (argc - 1 < c->min_args || argc - 1 > c->max_args || c->handler(argc, argv) != 0) {
+        print_usage(c);
+    }
+}
+
+// Generated from the table, so new commands show up without touching this
+static int cmd_help(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+
+    uart_println("Available commands:");
+    for (const struct bios_cmd* c = __bios_cmds_start; c < __bios_cmds_end; c++) {
+        uart_printf("  %-8s %-16s - %s\r\n", c->name, c->usage, c->help);
+    }
+    return 0;
+}
+
+BIOS_CMD(help, "", "Show this help", 0, 0, cmd_help);
@@ -1,5 +1,18 @@
 // uart.c - UART driver implementation for RISC-V64
 #include "uart.h"
+#include "printf.h"
+#include "atomic.h"
+#include "cmd.h"
+
+// Internal functions; kept out of uart.h so other files can include it
+static void handle_receive_interrupt(int timeout);
+static void handle_line_status_interrupt(void);
+static void handle_transmit_interrupt(void);
+static void handle_char(char c);
+static void set_rx_level(int level);
+static void print_per_byte(const char* label, unsigned int irqs, unsigned int bytes);
+static void handle_backspace(void);
+
 
 // UART register definitions
 #define UART_BASE       0x10000000UL
@@ -14,6 +27,24 @@
 #define UART_DLL        0x00    // Divisor Latch Low (when DLAB=1)
 #define UART_DLH        0x01    // Divisor Latch High (when DLAB=1)
 
+#define IER_RDI         0x01    // Received data available
+#define IER_THRI        0x02    // Transmitter holding register empty
+#define IER_RLSI        0x04    // Receiver line status
+#define LSR_THRE        0x20
+
+#define FCR_ENABLE      0x01
+#define FCR_CLEAR_RX    0x02
+#define FCR_CLEAR_TX    0x04
+#define FCR_TRIGGER(l)  ((l) << 6)  // RX trigger level index, bytes in rx_trigger_bytes[]
+
+#define UART_FIFO_SIZE  16
+
+// RX trigger level adaptation: index 0 (1 byte) is never used, the FIFO
+// interrupts at 4/8/14 bytes and the character timeout picks up the tail.
+#define RX_LEVEL_MIN    1
+#define RX_LEVEL_MAX    3
+#define RX_BURST_UP     4       // Consecutive full-trigger interrupts before stepping up
+
 // UART register access macros
 #define UART_REG(offset) (*((volatile unsigned char*)(UART_BASE + (offset))))
 
@@ -21,7 +52,37 @@
 static char input_buffer[UART_BUFFER_SIZE];
 static int buffer_pos = 0;
 
+// Receive ring: the ISR is the only producer and the main loop in bios.S the
+// only consumer, so the two indices need ordering but no lock. The ISR only
+// moves bytes from the FIFO into the ring; echo, line editing and command
+// dispatch all run in uart_process_input() with interrupts enabled.
+static char rx_ring[UART_RX_RING_SIZE];
+static volatile uint32_t rx_head, rx_tail;
+static volatile uint32_t rx_dropped;    // Written by the ISR only
+static volatile uint32_t lsr_errors;    // LSR error bits seen by the ISR, reported by the main loop
+
+// Sustained input (a paste, a file upload) keeps reaching the trigger level,
+// so the level steps up and each interrupt carries more bytes; a character
+// timeout means input stalled below the level, so it steps back down. An
+// overrun drops straight to the minimum. Only the ISR touches these.
+static const uint8_t rx_trigger_bytes[] = {1, 4, 8, 14};
+static int rx_level = RX_LEVEL_MIN;
+static int rx_burst;
+
+// Transmit ring: the main loop is the only producer and the THRE interrupt
+// the only consumer, refilling the FIFO up to 16 bytes per interrupt. The
+// THRE interrupt is enabled only while the ring has data; tx_irq_on shadows
+// that bit and is changed with MIE clear on both sides.
+static char tx_ring[UART_TX_RING_SIZE];
+static volatile uint32_t tx_head, tx_tail;
+static volatile int tx_irq_on;
+static uint32_t tx_full_waits;          // Producer found the ring full
+
 // Statistics
+// Written on every byte, read only by the stats command. The BIOS runs on
+// one hart and the trap handler runs with MIE clear, so plain counters are
+// enough: the main flow updates its own counters with MIE clear, and
+// uart_get_stats() masks MIE while it copies the whole set.
 static uart_stats_t stats = {0};
 
 // Initialize UART with specified baud rate
@@ -40,275 +101,354 @@ void uart_init(unsigned int baud_rate) {
     // Configure line: 8N1 (8 bits, no parity, 1 stop bit)
     UART_REG(UART_LCR) = 0x03;
     
-    // Enable FIFO with 4-byte trigger level
-    UART_REG(UART_FCR) = 0x07;
+    // Reset and enable the FIFOs, starting at the lowest adaptive trigger level
+    rx_level = RX_LEVEL_MIN;
+    rx_burst = 0;
+    UART_REG(UART_FCR) = FCR_ENABLE | FCR_CLEAR_RX | FCR_CLEAR_TX | FCR_TRIGGER(rx_level);
     
-    // Enable receive and line status interrupts
-    UART_REG(UART_IER) = 0x05;
+    // Enable receive and line status interrupts; THRE is enabled on demand
+    UART_REG(UART_IER) = IER_RDI | IER_RLSI;
     
     // Reset statistics
     stats.bytes_received = 0;
     stats.bytes_transmitted = 0;
     stats.lines_processed = 0;
+    stats.interrupts = 0;
+    stats.rx_interrupts = 0;
+    stats.rx_timeouts = 0;
+    stats.tx_interrupts = 0;
+    stats.level_changes = 0;
+}
+
+// Move the whole ring out by polling LSR; caller has MIE clear
+static void tx_poll_drain(void) {
+    uint32_t tail = tx_tail;
+
+    while (tail != load_acquire32(&tx_head)) {
+        while (!(UART_REG(UART_LSR) & LSR_THRE));
+        UART_REG(UART_THR) = tx_ring[tail % UART_TX_RING_SIZE];
+        tail++;
+    }
+    store_release32(&tx_tail, tail);
+}
+
+// Queue len bytes with MIE masked once for the whole message; only waits
+// when the ring is full, then carries on with whatever did not fit
+void uart_write(const char* buf, unsigned int len) {
+    unsigned long mstatus;
+
+    asm volatile("csrrci %0, mstatus, 8" : "=r"(mstatus) : : "memory");
+    stats.bytes_transmitted += len;
+    while (len > 0) {
+        uint32_t head = tx_head;
+        uint32_t room = UART_TX_RING_SIZE - (head - load_acquire32(&tx_tail));
+
+        if (room == 0) {
+            tx_full_waits++;
+            if (mstatus & 8) {
+                // wfi wakes on the pending THRE interrupt even with MIE clear,
+                // the trap is taken in the window where MIE is set again
+                asm volatile("wfi");
+                asm volatile("csrsi mstatus, 8" : : : "memory");
+                asm volatile("csrci mstatus, 8" : : : "memory");
+            } else {
+                // Interrupts are off (early boot), nobody else will drain it
+                tx_poll_drain();
+            }
+            continue;
+        }
+
+        uint32_t n = len < room ? len : room;
+        for (uint32_t i = 0; i < n; i++) {
+            tx_ring[(head + i) % UART_TX_RING_SIZE] = buf[i];
+        }
+        store_release32(&tx_head, head + n);
+        buf += n;
+        len -= n;
+        if (!tx_irq_on) {
+            // The UART raises THRE right away if the holding register is empty
+            tx_irq_on = 1;
+            UART_REG(UART_IER) = IER_RDI | IER_RLSI | IER_THRI;
+        }
+    }
+    if (mstatus & 8) {
+        asm volatile("csrsi mstatus, 8" : : : "memory");
+    }
 }
 
-// Send a single character (blocking)
 void uart_putc(char c) {
-    // Wait for transmitter to be ready
-    while (!(UART_REG(UART_LSR) & 0x20));
-    
-    // Send character
-    UART_REG(UART_THR) = c;
-    stats.bytes_transmitted++;
+    uart_write(&c, 1);
+}
+
+// Wait until everything queued is on the wire (polls, used before reset)
+void uart_flush(void) {
+    unsigned long mstatus;
+
+    asm volatile("csrrci %0, mstatus, 8" : "=r"(mstatus) : : "memory");
+    tx_poll_drain();
+    while (!(UART_REG(UART_LSR) & 0x40));   // Transmitter empty
+    if (mstatus & 8) {
+        asm volatile("csrsi mstatus, 8" : : : "memory");
+    }
+}
+
+// Unexpected trap: flush what is queued, then print by polling and stop.
+// Runs in the trap handler, so nothing here may rely on interrupts.
+void bios_panic(unsigned long mcause, unsigned long mepc, unsigned long mtval) {
+    char buffer[UART_PRINTF_BUFFER_SIZE];
+
+    asm volatile("csrci mstatus, 8" : : : "memory");
+    tx_poll_drain();
+    snprintf(buffer, sizeof(buffer), "\r\nBIOS panic: mcause=0x%lx mepc=0x%lx mtval=0x%lx\r\n",
+             mcause, mepc, mtval);
+    for (const char* p = buffer; *p; p++) {
+        while (!(UART_REG(UART_LSR) & LSR_THRE));
+        UART_REG(UART_THR) = *p;
+    }
+    for (;;) {
+        asm volatile("wfi");
+    }
 }
 
 // Send a string
 void uart_puts(const char* str) {
-    while (*str) {
-        uart_putc(*str++);
+    unsigned int len = 0;
+
+    while (str[len]) {
+        len++;
     }
+    uart_write(str, len);
 }
 
 // Send a string with newline
 void uart_println(const char* str) {
     uart_puts(str);
-    uart_putc('\r');
-    uart_putc('\n');
+    uart_write("\r\n", 2);
 }
 
-// Print formatted string (simple printf implementation)
+// Print formatted string
+// Formatting is done by the shared vsnprintf (common/printf.c) into a local
+// buffer, then the whole message is sent in one go.
 void uart_printf(const char* format, ...) {
-    // Simple implementation - only supports %s, %d, %x, %c
-    const char* p = format;
+    char buffer[UART_PRINTF_BUFFER_SIZE];
     va_list args;
+    int len;
+
     va_start(args, format);
-    
-    while (*p) {
-        if (*p == '%' && *(p + 1)) {
-            p++;
-            switch (*p) {
-                case 's': {
-                    const char* str = va_arg(args, const char*);
-                    uart_puts(str ? str : "(null)");
-                    break;
-                }
-                case 'd': {
-                    int num = va_arg(args, int);
-                    uart_print_int(num);
-                    break;
-                }
-                case 'x': {
-                    unsigned int num = va_arg(args, unsigned int);
-                    uart_print_hex(num);
-                    break;
-                }
-                case 'c': {
-                    char c = (char)va_arg(args, int);
-                    uart_putc(c);
-                    break;
-                }
-                case '%':
-                    uart_putc('%');
-                    break;
-                default:
-                    uart_putc('%');
-                    uart_putc(*p);
-                    break;
-            }
-        } else {
-            uart_putc(*p);
-        }
-        p++;
-    }
-    
+    len = vsnprintf(buffer, sizeof(buffer), format, args);
     va_end(args);
+
+    if (len >= (int)sizeof(buffer)) {
+        len = sizeof(buffer) - 1;   // Truncated
+    }
+    uart_write(buffer, len);
 }
 
 // Print integer
 void uart_print_int(int num) {
-    if (num == 0) {
-        uart_putc('0');
-        return;
-    }
-    
-    if (num < 0) {
-        uart_putc('-');
-        num = -num;
-    }
-    
-    char buffer[12]; // Enough for 32-bit int
-    int pos = 0;
-    
-    while (num > 0) {
-        buffer[pos++] = '0' + (num % 10);
-        num /= 10;
-    }
-    
-    // Print digits in reverse order
-    while (pos > 0) {
-        uart_putc(buffer[--pos]);
-    }
+    uart_printf("%d", num);
 }
 
 // Print hexadecimal number
 void uart_print_hex(unsigned int num) {
-    uart_puts("0x");
-    
-    if (num == 0) {
-        uart_putc('0');
+    uart_printf("0x%X", num);
+}
+
+// Ratio with two decimals, e.g. "0.07"
+static void print_per_byte(const char* label, unsigned int irqs, unsigned int bytes) {
+    if (bytes == 0) {
+        uart_printf("%s-\r\n", label);
         return;
     }
-    
-    char buffer[9]; // 8 hex digits + null
-    int pos = 0;
-    
-    while (num > 0) {
-        int digit = num & 0xF;
-        buffer[pos++] = digit < 10 ? '0' + digit : 'A' + digit - 10;
-        num >>= 4;
-    }
-    
-    // Print digits in reverse order
-    while (pos > 0) {
-        uart_putc(buffer[--pos]);
-    }
+    unsigned int hundredths = (unsigned int)((uint64_t)irqs * 100 / bytes);
+    uart_printf("%s%u.%02u\r\n", label, hundredths / 100, hundredths % 100);
 }
 
-// Process a complete command line
-static void process_command(const char* cmd) {
-    if (cmd[0] == '\0') {
-        return; // Empty command
-    }
-    
-    // Simple command processing
-    if (strcmp(cmd, "help") == 0) {
-        uart_println("Available commands:");
-        uart_println("  help     - Show this help");
-        uart_println("  stats    - Show UART statistics");
-        uart_println("  clear    - Clear screen");
-        uart_println("  echo     - Echo test");
-        uart_println("  reboot   - Restart system");
-    }
-    else if (strcmp(cmd, "stats") == 0) {
-        uart_printf("UART Statistics:\r\n");
-        uart_printf("  Bytes received: %d\r\n", stats.bytes_received);
-        uart_printf("  Bytes transmitted: %d\r\n", stats.bytes_transmitted);
-        uart_printf("  Lines processed: %d\r\n", stats.lines_processed);
-    }
-    else if (strcmp(cmd, "clear") == 0) {
-        // Send ANSI clear screen sequence
-        uart_puts("\033[2J\033[H");
-    }
-    else if (strcmp(cmd, "echo") == 0) {
+// Monitor commands implemented by this driver
+static int cmd_stats(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+
+    uart_stats_t snap = uart_get_stats();
+    uart_printf("UART Statistics:\r\n");
+    uart_printf("  Bytes received: %u\r\n", snap.bytes_received);
+    uart_printf("  Bytes transmitted: %u\r\n", snap.bytes_transmitted);
+    uart_printf("  Lines processed: %u\r\n", snap.lines_processed);
+    uart_printf("  Interrupts: %u (RX %u, of which timeout %u; TX %u)\r\n", snap.interrupts,
+                snap.rx_interrupts, snap.rx_timeouts, snap.tx_interrupts);
+    print_per_byte("  RX interrupts per byte: ", snap.rx_interrupts, snap.bytes_received);
+    print_per_byte("  TX interrupts per byte: ", snap.tx_interrupts, snap.bytes_transmitted);
+    uart_printf("  RX trigger level: %u bytes (%u changes)\r\n",
+                rx_trigger_bytes[rx_level], snap.level_changes);
+    uart_printf("  RX ring overflows: %u\r\n", rx_dropped);
+    uart_printf("  TX ring full waits: %u\r\n", tx_full_waits);
+    return 0;
+}
+
+static int cmd_clear(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+
+    // Send ANSI clear screen sequence
+    uart_puts("\033[2J\033[H");
+    return 0;
+}
+
+static int cmd_echo(int argc, char** argv) {
+    if (argc == 1) {
         uart_println("Echo test - type something:");
         // Echo mode - just continue normal echo behavior
+        return 0;
     }
-    else if (strcmp(cmd, "reboot") == 0) {
-        uart_println("Rebooting system...");
-        // In a real system, this would trigger a reset
-        // For now, just show message
-        system_reboot();
-    }
-    else {
-        uart_printf("Unknown command: %s\r\n", cmd);
-        uart_println("Type 'help' for available commands.");
+    for (int i = 1; i < argc; i++) {
+        uart_puts(argv[i]);
+        uart_putc(i + 1 < argc ? ' ' : '\r');
     }
+    uart_putc('\n');
+    return 0;
+}
+
+static int cmd_reboot(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+
+    uart_println("Rebooting system...");
+    uart_flush();
+    system_reboot();
+    return 0;
 }
 
+BIOS_CMD(stats, "", "Show UART statistics", 0, 0, cmd_stats);
+BIOS_CMD(clear, "", "Clear screen", 0, 0, cmd_clear);
+BIOS_CMD(echo, "[text...]", "Echo test / print arguments", 0, CMD_MAX_ARGS - 1, cmd_echo);
+BIOS_CMD(reboot, "", "Restart system", 0, 0, cmd_reboot);
+
 // Handle backspace/delete
 static void handle_backspace(void) {
     if (buffer_pos > 0) {
         buffer_pos--;
         // Send backspace sequence: backspace, space, backspace
-        uart_putc('\b');
-        uart_putc(' ');
-        uart_putc('\b');
+        uart_write("\b \b", 3);
     }
 }
 
 // UART interrupt handler (called from assembly)
+// Serves every pending cause before returning, so one PLIC claim covers
+// e.g. a receive and a transmit interrupt raised together
 void uart_interrupt_handler(void) {
-    unsigned char iir = UART_REG(UART_IIR);
-    
-    // Check interrupt type
-    switch (iir & 0x0F) {
-        case 0x04: // Received Data Available
-        case 0x0C: // Character Timeout
-            handle_receive_interrupt();
-            break;
-            
-        case 0x02: // Transmitter Holding Register Empty
-            // Handle transmit interrupt if needed
-            break;
-            
-        case 0x06: // Receiver Line Status
-            // Handle line status errors
-            handle_line_status_interrupt();
-            break;
-            
-        default:
-            break;
+    int rx = 0, timeout = 0, tx = 0;
+
+    for (;;) {
+        unsigned char iir = UART_REG(UART_IIR);
+        if (iir & 0x01) {
+            break; // No interrupt pending
+        }
+
+        // Check interrupt type
+        switch (iir & 0x0F) {
+            case 0x04: // Received Data Available
+            case 0x0C: // Character Timeout
+                rx = 1;
+                timeout |= (iir & 0x0F) == 0x0C;
+                handle_receive_interrupt((iir & 0x0F) == 0x0C);
+                continue;
+
+            case 0x02: // Transmitter Holding Register Empty
+                tx = 1;
+                handle_transmit_interrupt();
+                continue;
+
+            case 0x06: // Receiver Line Status
+                // Handle line status errors
+                handle_line_status_interrupt();
+                continue;
+
+            default:
+                break;
+        }
+        break;
+    }
+
+    stats.interrupts++;
+    stats.rx_interrupts += rx;
+    stats.rx_timeouts += timeout;
+    stats.tx_interrupts += tx;
+}
+
+static void set_rx_level(int level) {
+    if (level == rx_level) {
+        return;
     }
+    rx_level = level;
+    rx_burst = 0;
+    // Without the clear bits this only changes the trigger, queued bytes stay
+    UART_REG(UART_FCR) = FCR_ENABLE | FCR_TRIGGER(level);
+    stats.level_changes++;
 }
 
-// Handle receive interrupt
-static void handle_receive_interrupt(void) {
+// Handle receive interrupt: drain the FIFO into the ring in one go, then
+// adjust the trigger level from how this interrupt was raised
+static void handle_receive_interrupt(int timeout) {
+    uint32_t head = rx_head;
+    uint32_t tail = load_acquire32(&rx_tail);
+    unsigned int n = 0;
+
     while (UART_REG(UART_LSR) & 0x01) { // Data available
         char c = UART_REG(UART_RBR);
-        stats.bytes_received++;
-        
-        // Handle special characters
-        switch (c) {
-            case '\r': // Carriage return
-            case '\n': // Line feed
-                uart_putc('\r');
-                uart_putc('\n');
-                
-                // Process the command
-                input_buffer[buffer_pos] = '\0';
-                process_command(input_buffer);
-                stats.lines_processed++;
-                
-                // Reset buffer and show prompt
-                buffer_pos = 0;
-                uart_puts("BIOS> ");
-                break;
-                
-            case '\b': // Backspace
-            case 0x7F: // Delete
-                handle_backspace();
-                break;
-                
-            case 0x03: // Ctrl+C
-                uart_println("^C");
-                buffer_pos = 0;
-                uart_puts("BIOS> ");
-                break;
-                
-            case 0x04: // Ctrl+D (EOF)
-                uart_println("Goodbye!");
-                // Could implement shutdown here
-                break;
-                
-            default:
-                // Printable character
-                if (c >= 0x20 && c <= 0x7E) {
-                    if (buffer_pos < UART_BUFFER_SIZE - 1) {
-                        input_buffer[buffer_pos++] = c;
-                        uart_putc(c); // Echo character
-                    } else {
-                        uart_putc('\a'); // Bell - buffer full
-                    }
-                }
-                break;
+        if (head - tail < UART_RX_RING_SIZE) {
+            rx_ring[head % UART_RX_RING_SIZE] = c;
+            head++;
+        } else {
+            rx_dropped++;
         }
+        n++;
     }
+    store_release32(&rx_head, head);
+
+    if (timeout) {
+        if (rx_level > RX_LEVEL_MIN) {
+            set_rx_level(rx_level - 1);
+        }
+        rx_burst = 0;
+    } else if (n >= rx_trigger_bytes[rx_level] && ++rx_burst >= RX_BURST_UP &&
+               rx_level < RX_LEVEL_MAX) {
+        set_rx_level(rx_level + 1);
+    }
+
+    stats.bytes_received += n;
 }
 
-// Handle line status interrupt (errors)
+// Handle transmit interrupt: refill the FIFO from the ring, at most its depth
+static void handle_transmit_interrupt(void) {
+    uint32_t tail = tx_tail;
+    uint32_t head = load_acquire32(&tx_head);
+
+    if (UART_REG(UART_LSR) & LSR_THRE) {
+        for (int i = 0; i < UART_FIFO_SIZE && tail != head; i++) {
+            UART_REG(UART_THR) = tx_ring[tail % UART_TX_RING_SIZE];
+            tail++;
+        }
+        store_release32(&tx_tail, tail);
+    }
+    if (tail == head) {
+        tx_irq_on = 0;
+        UART_REG(UART_IER) = IER_RDI | IER_RLSI;
+    }
+}
+
+// Handle line status interrupt (errors): reading LSR clears the condition,
+// the message is printed later by the main loop
 static void handle_line_status_interrupt(void) {
     unsigned char lsr = UART_REG(UART_LSR);
-    
+
+    atomic_fetch_or32(&lsr_errors, lsr & 0x1E);
+    if (lsr & 0x02) {
+        // Overrun: the ISR did not get there in time, leave more FIFO headroom
+        set_rx_level(RX_LEVEL_MIN);
+    }
+}
+
+static void report_line_status(uint32_t lsr) {
     if (lsr & 0x02) {
         uart_println("UART: Overrun error");
     }
@@ -323,9 +463,87 @@ static void handle_line_status_interrupt(void) {
     }
 }
 
+// Line editing for one received character
+static void handle_char(char c) {
+    // Handle special characters
+    switch (c) {
+        case '\r': // Carriage return
+        case '\n': // Line feed
+            uart_write("\r\n", 2);
+
+            // Process the command
+            input_buffer[buffer_pos] = '\0';
+            cmd_dispatch(input_buffer);
+            stats.lines_processed++;
+
+            // Reset buffer and show prompt
+            buffer_pos = 0;
+            uart_puts("BIOS> ");
+            break;
+
+        case '\b': // Backspace
+        case 0x7F: // Delete
+            handle_backspace();
+            break;
+
+        case 0x03: // Ctrl+C
+            uart_println("^C");
+            buffer_pos = 0;
+            uart_puts("BIOS> ");
+            break;
+
+        case 0x04: // Ctrl+D (EOF)
+            uart_println("Goodbye!");
+            // Could implement shutdown here
+            break;
+
+        default:
+            // Printable character
+            if (c >= 0x20 && c <= 0x7E) {
+                if (buffer_pos < UART_BUFFER_SIZE - 1) {
+                    input_buffer[buffer_pos++] = c;
+                    uart_putc(c); // Echo character
+                } else {
+                    uart_putc('\a'); // Bell - buffer full
+                }
+            }
+            break;
+    }
+}
+
+// Called by the main loop with MIE clear, right before wfi
+int uart_rx_pending(void) {
+    return rx_tail != load_acquire32(&rx_head) || lsr_errors != 0;
+}
+
+// Main loop work: consume everything the ISR has queued
+void uart_process_input(void) {
+    uint32_t err = atomic_swap32_acquire(&lsr_errors, 0);
+    if (err != 0) {
+        report_line_status(err);
+    }
+
+    uint32_t tail = rx_tail;
+    while (tail != load_acquire32(&rx_head)) {
+        char c = rx_ring[tail % UART_RX_RING_SIZE];
+        tail++;
+        // Hand the slot back before running the (possibly slow) command
+        store_release32(&rx_tail, tail);
+        handle_char(c);
+    }
+}
+
 // Get UART statistics
 uart_stats_t uart_get_stats(void) {
-    return stats;
+    uart_stats_t snap;
+    unsigned long mstatus;
+
+    asm volatile("csrrci %0, mstatus, 8" : "=r"(mstatus) : : "memory");
+    snap = stats;
+    if (mstatus & 8) {
+        asm volatile("csrsi mstatus, 8" : : : "memory");
+    }
+    return snap;
 }
 
 // Simple string comparison
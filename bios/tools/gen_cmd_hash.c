@@ -0,0 +1,89 @@
+// Runs on the build host: builds the perfect hash for the BIOS command table
+// Usage: gen_cmd_hash name... > cmd_hash.h
+// The names are sorted the same way the linker's SORT_BY_NAME orders the
+// .bios_cmds.<name> sections, so table index i is the i-th name in strcmp order.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmd.h"
+
+#define MAX_CMDS    127         // Slots hold int8_t indices
+#define MAX_SEED    1000000u
+
+static int cmp_name(const void* a, const void* b) {
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+// Fill slots[] for the given seed; 0 if every name got its own slot
+static int try_seed(char** names, int n, uint32_t seed, int bits, int* slots) {
+    uint32_t mask = (1u << bits) - 1;
+
+    for (uint32_t i = 0; i <= mask; i++) {
+        slots[i] = -1;
+    }
+    for (int i = 0; i < n; i++) {
+        uint32_t s = cmd_hash(names[i], seed) & mask;
+        if (slots[s] >= 0) {
+            return -1;
+        }
+        slots[s] = i;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    char** names = argv + 1;
+    int n = argc - 1;
+    static int slots[1 << 16];
+
+    if (n == 0 || n > MAX_CMDS) {
+        fprintf(stderr, "gen_cmd_hash: need 1..%d command names, got %d\n", MAX_CMDS, n);
+        return 1;
+    }
+    qsort(names, n, sizeof(names[0]), cmp_name);
+    for (int i = 1; i < n; i++) {
+        if (strcmp(names[i - 1], names[i]) == 0) {
+            fprintf(stderr, "gen_cmd_hash: command '%s' registered twice\n", names[i]);
+            return 1;
+        }
+    }
+
+    // Start at twice the command count so a seed is found quickly
+    int bits = 2;
+    while ((1 << bits) < 2 * n) {
+        bits++;
+    }
+    uint32_t seed = 0;
+    for (; bits <= 16; bits++) {
+        for (seed = 0; seed < MAX_SEED; seed++) {
+            if (try_seed(names, n, seed, bits, slots) == 0) {
+                break;
+            }
+        }
+        if (seed < MAX_SEED) {
+            break;
+        }
+    }
+    if (bits > 16) {
+        fprintf(stderr, "gen_cmd_hash: no perfect hash found\n");
+        return 1;
+    }
+
+    printf("// generated by tools/gen_cmd_hash.c, do not edit\n");
+    printf("#ifndef __BIOS_CMD_HASH_H__\n#define __BIOS_CMD_HASH_H__\n\n");
+    printf("#define CMD_COUNT       %d\n", n);
+    printf("#define CMD_HASH_SEED   0x%xu\n", seed);
+    printf("#define CMD_HASH_BITS   %d\n\n", bits);
+    printf("// slot -> index into the sorted command table, -1 if empty\n");
+    printf("static const int8_t cmd_hash_slots[1 << CMD_HASH_BITS] = {\n");
+    for (int i = 0; i < (1 << bits); i++) {
+        if (slots[i] >= 0) {
+            printf("    %d,     // %s\n", slots[i], names[slots[i]]);
+        } else {
+            printf("    -1,\n");
+        }
+    }
+    printf("};\n\n#endif /* __BIOS_CMD_HASH_H__ */\n");
+    return 0;
+}
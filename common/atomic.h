@@ -0,0 +1,136 @@
+#ifndef __COMMON_ATOMIC_H__
+#define __COMMON_ATOMIC_H__
+
+// os/和bios/共用的原子操作与内存屏障，直接用A扩展的amo*/lr/sc指令
+// 命名中的acquire/release对应指令上的.aq/.rl位；不在RISC-V上编译时退回GCC内建函数
+
+#include <stdint.h>
+
+#if defined(__riscv)
+
+#define smp_mb()    asm volatile("fence rw, rw" ::: "memory")
+#define smp_rmb()   asm volatile("fence r, r" ::: "memory")
+#define smp_wmb()   asm volatile("fence w, w" ::: "memory")
+
+// Zihintpause的pause（fence w, 0），不支持的实现当作无副作用的fence
+#define cpu_relax() asm volatile(".insn i 0x0f, 0, x0, x0, 0x010" ::: "memory")
+
+static inline uint32_t atomic_swap32_acquire(volatile uint32_t *p, uint32_t v) {
+    uint32_t old;
+    asm volatile("amoswap.w.aq %0, %2, %1" : "=r"(old), "+A"(*p) : "r"(v) : "memory");
+    return old;
+}
+
+static inline uint32_t atomic_fetch_add32(volatile uint32_t *p, uint32_t v) {
+    uint32_t old;
+    asm volatile("amoadd.w %0, %2, %1" : "=r"(old), "+A"(*p) : "r"(v) : "memory");
+    return old;
+}
+
+static inline uint64_t atomic_fetch_add64(volatile uint64_t *p, uint64_t v) {
+    uint64_t old;
+    asm volatile("amoadd.d %0, %2, %1" : "=r"(old), "+A"(*p) : "r"(v) : "memory");
+    return old;
+}
+
+static inline uint32_t atomic_fetch_or32(volatile uint32_t *p, uint32_t v) {
+    uint32_t old;
+    asm volatile("amoor.w %0, %2, %1" : "=r"(old), "+A"(*p) : "r"(v) : "memory");
+    return old;
+}
+
+// 成功返回1；lr.w把读到的值符号扩展，old同样按int符号扩展后再比较
+// rc先置1，sc失败时也写非0，因此只有sc成功才会以rc == 0离开
+static inline int atomic_cas32(volatile uint32_t *p, uint32_t old, uint32_t new) {
+    long cur, rc;
+    asm volatile("   li %1, 1\n"
+                 "1: lr.w.aq %0, %2\n"
+                 "   bne %0, %3, 2f\n"
+                 "   sc.w.rl %1, %4, %2\n"
+                 "   bnez %1, 1b\n"
+                 "2:"
+                 : "=&r"(cur), "=&r"(rc), "+A"(*p)
+                 : "r"((long)(int)old), "r"(new)
+                 : "memory");
+    return rc == 0;
+}
+
+static inline void *atomic_swap_ptr(void *volatile *p, void *v) {
+    void *old;
+    asm volatile("amoswap.d.aqrl %0, %2, %1" : "=r"(old), "+A"(*p) : "r"(v) : "memory");
+    return old;
+}
+
+static inline int atomic_cas_ptr(void *volatile *p, void *old, void *new) {
+    void *cur;
+    long rc;
+    asm volatile("   li %1, 1\n"
+                 "1: lr.d.aq %0, %2\n"
+                 "   bne %0, %3, 2f\n"
+                 "   sc.d.rl %1, %4, %2\n"
+                 "   bnez %1, 1b\n"
+                 "2:"
+                 : "=&r"(cur), "=&r"(rc), "+A"(*p)
+                 : "r"(old), "r"(new)
+                 : "memory");
+    return rc == 0;
+}
+
+#else
+
+#define smp_mb()    __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define smp_rmb()   __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define smp_wmb()   __atomic_thread_fence(__ATOMIC_RELEASE)
+#define cpu_relax() asm volatile("" ::: "memory")
+
+static inline uint32_t atomic_swap32_acquire(volatile uint32_t *p, uint32_t v) {
+    return __atomic_exchange_n(p, v, __ATOMIC_ACQUIRE);
+}
+
+static inline uint32_t atomic_fetch_add32(volatile uint32_t *p, uint32_t v) {
+    return __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t atomic_fetch_add64(volatile uint64_t *p, uint64_t v) {
+    return __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+}
+
+static inline uint32_t atomic_fetch_or32(volatile uint32_t *p, uint32_t v) {
+    return __atomic_fetch_or(p, v, __ATOMIC_RELAXED);
+}
+
+static inline int atomic_cas32(volatile uint32_t *p, uint32_t old, uint32_t new) {
+    return __atomic_compare_exchange_n(p, &old, new, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static inline void *atomic_swap_ptr(void *volatile *p, void *v) {
+    return __atomic_exchange_n(p, v, __ATOMIC_ACQ_REL);
+}
+
+static inline int atomic_cas_ptr(void *volatile *p, void *old, void *new) {
+    return __atomic_compare_exchange_n(p, &old, new, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+#endif
+
+// RVWMO下的获取读/释放写：fence r, rw放在读之后，fence rw, w放在写之前
+static inline uint32_t load_acquire32(const volatile uint32_t *p) {
+    uint32_t v = *p;
+#if defined(__riscv)
+    asm volatile("fence r, rw" ::: "memory");
+#else
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+    return v;
+}
+
+static inline void store_release32(volatile uint32_t *p, uint32_t v) {
+#if defined(__riscv)
+    asm volatile("fence rw, w" ::: "memory");
+#else
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+    *p = v;
+}
+
+#endif /* __COMMON_ATOMIC_H__ */
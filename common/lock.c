@@ -0,0 +1,211 @@
+#include <stdint.h>
+#include "atomic.h"
+#include "lock.h"
+#include "printf.h"
+
+// 统计字段只在持锁期间修改，不需要原子操作；
+// 登记表的下标用amoadd分配，各锁只在第一次获取时（已持锁）登记一次
+
+static struct lock_stat *volatile lock_stats[LOCK_STAT_MAX];
+static volatile uint32_t nr_lock_stats;
+
+#if CONFIG_LOCK_STAT
+
+static void stat_acquired(struct lock_stat *s, int contended, uint64_t wait_start) {
+    uint64_t now = lock_clock();
+
+    if (!s->registered) {
+        s->registered = 1;
+        uint32_t idx = atomic_fetch_add32(&nr_lock_stats, 1);
+        if (idx < LOCK_STAT_MAX) {
+            lock_stats[idx] = s;
+        }
+    }
+
+    s->acquired++;
+    if (contended) {
+        uint64_t wait = now - wait_start;
+        s->contended++;
+        s->wait_total += wait;
+        if (wait > s->wait_max) {
+            s->wait_max = wait;
+        }
+    }
+    s->hold_start = now;
+}
+
+static void stat_released(struct lock_stat *s) {
+    uint64_t hold = lock_clock() - s->hold_start;
+
+    s->hold_total += hold;
+    if (hold > s->hold_max) {
+        s->hold_max = hold;
+    }
+}
+
+#define STAT_NOW()  lock_clock()
+
+#else
+
+#define stat_acquired(s, contended, wait_start) ((void)(contended), (void)(wait_start))
+#define stat_released(s)                        ((void)0)
+#define STAT_NOW()                              0
+
+#endif
+
+static void stat_init(struct lock_stat *s, const char *name) {
+    *s = (struct lock_stat)LOCK_STAT_INIT(name);
+}
+
+void tas_lock_init(struct tas_lock *l, const char *name) {
+    l->locked = 0;
+    stat_init(&l->stat, name);
+}
+
+void tas_acquire(struct tas_lock *l) {
+    int contended = 0;
+    uint64_t wait_start = 0;
+
+    while (atomic_swap32_acquire(&l->locked, 1) != 0) {
+        if (!contended) {
+            contended = 1;
+            wait_start = STAT_NOW();
+        }
+        // 只读自旋，锁被释放之前不再发出写请求
+        while (l->locked) {
+            cpu_relax();
+        }
+    }
+    stat_acquired(&l->stat, contended, wait_start);
+}
+
+int tas_tryacquire(struct tas_lock *l) {
+    if (l->locked || atomic_swap32_acquire(&l->locked, 1) != 0) {
+        return 0;
+    }
+    stat_acquired(&l->stat, 0, 0);
+    return 1;
+}
+
+void tas_release(struct tas_lock *l) {
+    stat_released(&l->stat);
+    store_release32(&l->locked, 0);
+}
+
+void ticket_lock_init(struct ticket_lock *l, const char *name) {
+    l->next = 0;
+    l->owner = 0;
+    stat_init(&l->stat, name);
+}
+
+void ticket_acquire(struct ticket_lock *l) {
+    uint32_t me = atomic_fetch_add32(&l->next, 1);
+    int contended = 0;
+    uint64_t wait_start = 0;
+
+    if (load_acquire32(&l->owner) != me) {
+        contended = 1;
+        wait_start = STAT_NOW();
+        while (load_acquire32(&l->owner) != me) {
+            cpu_relax();
+        }
+    }
+    stat_acquired(&l->stat, contended, wait_start);
+}
+
+// 只有在没有人排队时才取号，否则直接失败，不会插队
+int ticket_tryacquire(struct ticket_lock *l) {
+    uint32_t owner = l->owner;
+
+    if (l->next != owner || !atomic_cas32(&l->next, owner, owner + 1)) {
+        return 0;
+    }
+    stat_acquired(&l->stat, 0, 0);
+    return 1;
+}
+
+// owner只有持锁者写，普通读加一后释放写即可
+void ticket_release(struct ticket_lock *l) {
+    stat_released(&l->stat);
+    store_release32(&l->owner, l->owner + 1);
+}
+
+void mcs_lock_init(struct mcs_lock *l, const char *name) {
+    l->tail = 0;
+    stat_init(&l->stat, name);
+}
+
+void mcs_acquire(struct mcs_lock *l, struct mcs_node *node) {
+    int contended = 0;
+    uint64_t wait_start = 0;
+
+    node->next = 0;
+    node->locked = 1;
+    // amoswap.d.aqrl：节点的初始化先于入队可见，同时获得前驱释放的数据
+    struct mcs_node *prev = atomic_swap_ptr((void *volatile *)&l->tail, node);
+    if (prev != 0) {
+        contended = 1;
+        wait_start = STAT_NOW();
+        prev->next = node;
+        while (load_acquire32(&node->locked)) {
+            cpu_relax();
+        }
+    }
+    stat_acquired(&l->stat, contended, wait_start);
+}
+
+void mcs_release(struct mcs_lock *l, struct mcs_node *node) {
+    stat_released(&l->stat);
+
+    struct mcs_node *next = node->next;
+    if (next == 0) {
+        // 没有后继：把tail从自己换回空，sc.d.rl保证临界区的写先于释放可见
+        if (atomic_cas_ptr((void *volatile *)&l->tail, node, 0)) {
+            return;
+        }
+        // 后继已经入队但还没来得及链到本节点
+        while ((next = node->next) == 0) {
+            cpu_relax();
+        }
+    }
+    store_release32(&next->locked, 0);
+}
+
+void seqlock_init(struct seqlock *s, const char *name) {
+    s->seq = 0;
+    tas_lock_init(&s->wlock, name);
+}
+
+void write_seqlock(struct seqlock *s) {
+    tas_acquire(&s->wlock);
+    s->seq++;
+    smp_wmb();
+}
+
+void write_sequnlock(struct seqlock *s) {
+    smp_wmb();
+    s->seq++;
+    tas_release(&s->wlock);
+}
+
+void lock_stat_dump(void (*emit)(const char *line)) {
+    char line[128];
+    uint32_t n = nr_lock_stats;
+
+    if (n > LOCK_STAT_MAX) {
+        n = LOCK_STAT_MAX;
+    }
+    emit("name                 acquired  contended  wait-avg  wait-max  hold-avg  hold-max\n");
+    for (uint32_t i = 0; i < n; i++) {
+        struct lock_stat *s = lock_stats[i];
+        if (s == 0 || s->acquired == 0) {
+            continue;
+        }
+        uint64_t wait_avg = s->contended ? s->wait_total / s->contended : 0;
+        snprintf(line, sizeof(line), "%-20s %9lu %10lu %9lu %9lu %9lu %9lu\n",
+                 s->name, (unsigned long)s->acquired, (unsigned long)s->contended,
+                 (unsigned long)wait_avg, (unsigned long)s->wait_max,
+                 (unsigned long)(s->hold_total / s->acquired), (unsigned long)s->hold_max);
+        emit(line);
+    }
+}
@@ -0,0 +1,128 @@
+#ifndef __COMMON_LOCK_H__
+#define __COMMON_LOCK_H__
+
+// os/和bios/共用的锁原语，全部建立在atomic.h的amo*/lr/sc之上：
+//   tas_lock     测试-测试-置位自旋锁，最简单，适合几乎无竞争的场合
+//   ticket_lock  排号锁，先到先得，避免饥饿
+//   mcs_lock     排队锁，每个等待者只在自己的节点上自旋，竞争激烈时不会让同一缓存行来回迁移
+//   seqlock      顺序锁，读者不写共享内存，读多写少的数据在读者侧无锁
+// 这里只管互斥，关中断由调用者负责（os/的spin_lock在外层做push_off）。
+//
+// 每把锁带一个lock_stat，记录获取次数、发生竞争的次数、等待时间和持有时间（time计数），
+// 锁第一次被获取时自动登记，lock_stat_dump()列出所有登记过的锁。
+// 定义CONFIG_LOCK_STAT为0可以去掉计时开销。
+
+#include <stdint.h>
+#include "atomic.h"
+
+#ifndef CONFIG_LOCK_STAT
+#define CONFIG_LOCK_STAT    1
+#endif
+
+#define LOCK_STAT_MAX       64
+
+struct lock_stat {
+    const char *name;
+    uint64_t acquired;
+    uint64_t contended;     // 第一次尝试没拿到锁的次数
+    uint64_t wait_total;
+    uint64_t wait_max;
+    uint64_t hold_total;
+    uint64_t hold_max;
+    uint64_t hold_start;
+    uint32_t registered;
+};
+
+#define LOCK_STAT_INIT(n)   { .name = (n) }
+
+struct tas_lock {
+    volatile uint32_t locked;
+    struct lock_stat stat;
+};
+
+#define TAS_LOCK_INIT(n)    { .locked = 0, .stat = LOCK_STAT_INIT(n) }
+
+void tas_lock_init(struct tas_lock *l, const char *name);
+void tas_acquire(struct tas_lock *l);
+// 获取失败立即返回0，成功返回1
+int tas_tryacquire(struct tas_lock *l);
+void tas_release(struct tas_lock *l);
+
+// next是下一个发出的号，owner是正在服务的号
+struct ticket_lock {
+    volatile uint32_t next;
+    volatile uint32_t owner;
+    struct lock_stat stat;
+};
+
+#define TICKET_LOCK_INIT(n) { .next = 0, .owner = 0, .stat = LOCK_STAT_INIT(n) }
+
+void ticket_lock_init(struct ticket_lock *l, const char *name);
+void ticket_acquire(struct ticket_lock *l);
+int ticket_tryacquire(struct ticket_lock *l);
+void ticket_release(struct ticket_lock *l);
+
+static inline int ticket_is_locked(const struct ticket_lock *l) {
+    return l->next != l->owner;
+}
+
+// 等待节点由调用者提供（通常在栈上），获取和释放必须传同一个节点
+struct mcs_node {
+    struct mcs_node *volatile next;
+    volatile uint32_t locked;
+};
+
+struct mcs_lock {
+    struct mcs_node *volatile tail;
+    struct lock_stat stat;
+};
+
+#define MCS_LOCK_INIT(n)    { .tail = 0, .stat = LOCK_STAT_INIT(n) }
+
+void mcs_lock_init(struct mcs_lock *l, const char *name);
+void mcs_acquire(struct mcs_lock *l, struct mcs_node *node);
+void mcs_release(struct mcs_lock *l, struct mcs_node *node);
+
+// 写者之间用tas_lock互斥，序号为奇数表示正在写
+struct seqlock {
+    volatile uint32_t seq;
+    struct tas_lock wlock;
+};
+
+#define SEQLOCK_INIT(n)     { .seq = 0, .wlock = TAS_LOCK_INIT(n) }
+
+void seqlock_init(struct seqlock *s, const char *name);
+void write_seqlock(struct seqlock *s);
+void write_sequnlock(struct seqlock *s);
+
+// 读者用法：do { seq = read_seqbegin(s); 读数据 } while (read_seqretry(s, seq));
+static inline uint32_t read_seqbegin(const struct seqlock *s) {
+    uint32_t seq;
+
+    while ((seq = s->seq) & 1) {
+        cpu_relax();
+    }
+    smp_rmb();
+    return seq;
+}
+
+static inline int read_seqretry(const struct seqlock *s, uint32_t start) {
+    smp_rmb();
+    return s->seq != start;
+}
+
+// 读取时间戳：os/和bios/都运行在提供time CSR的平台上
+static inline uint64_t lock_clock(void) {
+#if defined(__riscv)
+    uint64_t t;
+    asm volatile("rdtime %0" : "=r"(t));
+    return t;
+#else
+    return 0;
+#endif
+}
+
+// 按登记顺序逐行输出统计，每行经emit输出；只列出获取过的锁
+void lock_stat_dump(void (*emit)(const char *line));
+
+#endif /* __COMMON_LOCK_H__ */
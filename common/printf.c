@@ -0,0 +1,222 @@
+#include <stdint.h>
+#include "printf.h"
+
+// 十进制转换不用除法：rv64imac上div/rem要几十个周期，
+// 这里用乘以倒数（mulhu）求商，再查两位一组的数字表，64位数最多10次乘法
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static inline uint64_t mulhu(uint64_t a, uint64_t b) {
+#if defined(__riscv)
+    uint64_t hi;
+    asm("mulhu %0, %1, %2" : "=r"(hi) : "r"(a), "r"(b));
+    return hi;
+#else
+    return (uint64_t)(((unsigned __int128)a * b) >> 64);
+#endif
+}
+
+// v / 100 = mulhu(v >> 2, ceil(2^68 / 100)) >> 2，对全部64位输入精确
+static inline uint64_t div100(uint64_t v) {
+    return mulhu(v >> 2, 0x28f5c28f5c28f5c3ULL) >> 2;
+}
+
+// 把v的十进制写到end之前，返回起始位置
+static char *fmt_u64_dec(char *end, uint64_t v) {
+    char *p = end;
+
+    while (v >= 100) {
+        uint64_t q = div100(v);
+        const char *d = &digit_pairs[(v - q * 100) * 2];
+        *--p = d[1];
+        *--p = d[0];
+        v = q;
+    }
+    if (v >= 10) {
+        *--p = digit_pairs[v * 2 + 1];
+        *--p = digit_pairs[v * 2];
+    } else {
+        *--p = '0' + v;
+    }
+    return p;
+}
+
+static char *fmt_u64_hex(char *end, uint64_t v, int upper) {
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char *p = end;
+
+    do {
+        *--p = digits[v & 0xf];
+        v >>= 4;
+    } while (v != 0);
+    return p;
+}
+
+struct fmt_out {
+    char *buf;
+    size_t size;
+    size_t pos;
+};
+
+static inline void out_char(struct fmt_out *o, char c) {
+    if (o->pos + 1 < o->size) {
+        o->buf[o->pos] = c;
+    }
+    o->pos++;
+}
+
+static void out_pad(struct fmt_out *o, char c, int n) {
+    while (n-- > 0) {
+        out_char(o, c);
+    }
+}
+
+// 按宽度和对齐输出一个字段；prefix（符号或"0x"）在补零时放在零之前
+static void out_field(struct fmt_out *o, const char *prefix, const char *s, int len,
+                      int width, int left, int zero) {
+    int plen = 0;
+    while (prefix[plen]) {
+        plen++;
+    }
+
+    int pad = width - plen - len;
+    if (!left && !zero) {
+        out_pad(o, ' ', pad);
+    }
+    for (int i = 0; i < plen; i++) {
+        out_char(o, prefix[i]);
+    }
+    if (!left && zero) {
+        out_pad(o, '0', pad);
+    }
+    for (int i = 0; i < len; i++) {
+        out_char(o, s[i]);
+    }
+    if (left) {
+        out_pad(o, ' ', pad);
+    }
+}
+
+int vsnprintf(char *buf, size_t size, const char *fmt, va_list ap) {
+    struct fmt_out o = { buf, size, 0 };
+    char tmp[24];
+    char *end = tmp + sizeof(tmp);
+
+    while (*fmt) {
+        if (*fmt != '%') {
+            out_char(&o, *fmt++);
+            continue;
+        }
+        fmt++;
+
+        int left = 0, zero = 0, width = 0, lng = 0;
+        for (;; fmt++) {
+            if (*fmt == '-') {
+                left = 1;
+            } else if (*fmt == '0') {
+                zero = 1;
+            } else {
+                break;
+            }
+        }
+        if (*fmt == '*') {
+            width = va_arg(ap, int);
+            if (width < 0) {
+                left = 1;
+                width = -width;
+            }
+            fmt++;
+        } else {
+            while (*fmt >= '0' && *fmt <= '9') {
+                width = width * 10 + (*fmt++ - '0');
+            }
+        }
+        while (*fmt == 'l' || *fmt == 'z') {
+            lng = 1;
+            fmt++;
+        }
+
+        const char *prefix = "";
+        char *s;
+        uint64_t u;
+        char c = *fmt;
+        if (c == '\0') {
+            break;
+        }
+        fmt++;
+
+        switch (c) {
+        case 'd':
+        case 'i': {
+            int64_t v = lng ? va_arg(ap, long) : va_arg(ap, int);
+            u = v < 0 ? -(uint64_t)v : (uint64_t)v;
+            prefix = v < 0 ? "-" : "";
+            s = fmt_u64_dec(end, u);
+            out_field(&o, prefix, s, end - s, width, left, zero);
+            break;
+        }
+        case 'u':
+            u = lng ? va_arg(ap, unsigned long) : va_arg(ap, unsigned int);
+            s = fmt_u64_dec(end, u);
+            out_field(&o, prefix, s, end - s, width, left, zero);
+            break;
+        case 'x':
+        case 'X':
+            u = lng ? va_arg(ap, unsigned long) : va_arg(ap, unsigned int);
+            s = fmt_u64_hex(end, u, c == 'X');
+            out_field(&o, prefix, s, end - s, width, left, zero);
+            break;
+        case 'p':
+            u = (uint64_t)(uintptr_t)va_arg(ap, void *);
+            s = fmt_u64_hex(end, u, 0);
+            out_field(&o, "0x", s, end - s, width, left, zero);
+            break;
+        case 's': {
+            const char *str = va_arg(ap, const char *);
+            int len = 0;
+            if (str == NULL) {
+                str = "(null)";
+            }
+            while (str[len]) {
+                len++;
+            }
+            out_field(&o, prefix, str, len, width, left, 0);
+            break;
+        }
+        case 'c':
+            tmp[0] = (char)va_arg(ap, int);
+            out_field(&o, prefix, tmp, 1, width, left, 0);
+            break;
+        case '%':
+            out_char(&o, '%');
+            break;
+        default:
+            out_char(&o, '%');
+            out_char(&o, c);
+            break;
+        }
+    }
+
+    if (size != 0) {
+        buf[o.pos < size ? o.pos : size - 1] = '\0';
+    }
+    return (int)o.pos;
+}
+
+int snprintf(char *buf, size_t size, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, size, fmt, ap);
+    va_end(ap);
+    return n;
+}
@@ -0,0 +1,16 @@
+#ifndef __COMMON_PRINTF_H__
+#define __COMMON_PRINTF_H__
+
+// os/和bios/共用的格式化输出，不依赖libc
+// 支持：%d %i %u %x %X %p %s %c %%，长度修饰l/ll/z，标志'-'/'0'，宽度（含'*'）
+// 结果一次写入调用者的缓冲区，超出部分截断，总是以'\0'结尾；
+// 返回值为不截断时应有的长度（不含'\0'），与C标准一致
+
+#include <stdarg.h>
+#include <stddef.h>
+
+int vsnprintf(char *buf, size_t size, const char *fmt, va_list ap);
+int snprintf(char *buf, size_t size, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#endif /* __COMMON_PRINTF_H__ */
@@ -0,0 +1,29 @@
+#ifndef __KERNEL_CONSOLE_H__
+#define __KERNEL_CONSOLE_H__
+
+#include <stdint.h>
+
+// 控制台后端
+enum console_backend {
+    CONSOLE_SBI_LEGACY = 0,     // 逐字节SBI_CONSOLE_PUTCHAR，仅作后备
+    CONSOLE_SBI_DBCN,           // SBI Debug Console扩展，一次ecall写整段
+    CONSOLE_UART,               // 内核自己的中断驱动UART，不再陷入固件
+};
+
+// 探测DBCN扩展并选择后端
+void console_init(void);
+enum console_backend console_get_backend(void);
+// UART驱动就绪后切换到CONSOLE_UART
+void console_set_backend(enum console_backend b);
+
+// 直接交给后端输出，由printk归并日志时调用
+void console_write(const char *s, int len);
+// 轮询输出，不使用中断和锁，仅用于panic/异常路径
+void console_write_sync(const char *s, int len);
+// 刷出日志并等待发送完成（关机前使用）
+void console_sync(void);
+
+// 读取一个输入字符，没有输入时返回-1
+int console_getc(void);
+
+#endif /* __KERNEL_CONSOLE_H__ */
@@ -0,0 +1,40 @@
+#ifndef __KERNEL_CPU_H__
+#define __KERNEL_CPU_H__
+
+#include <stdint.h>
+
+// 支持的最大hart数
+#define NCPU            8
+
+// 每个hart的私有数据，tp寄存器保存当前hart的逻辑编号
+// boot.S的从核入口按偏移读取id与stack_top，修改布局时需同步
+struct cpu {
+    int id;             // 逻辑编号，等于cpus[]下标
+    int noff;           // push_off嵌套深度
+    int intena;         // 第一次push_off之前中断是否打开
+    int reserved;
+    uint64_t hartid;    // 物理hart ID
+    uint64_t stack_top; // 内核栈顶
+    volatile int started;   // CPU_*，从核与启动hart用CAS决定上线还是放弃
+    uint64_t trap_stack_top;    // 陷入栈顶，空闲时保存在sscratch中
+};
+
+#define CPU_STARTING    0
+#define CPU_ONLINE      1
+#define CPU_ABANDONED   (-1)    // 启动超时，迟到的hart自行停住
+
+extern struct cpu cpus[NCPU];
+// cpus[0..nr_cpus)都已上线
+extern int nr_cpus;
+
+static inline int cpuid(void) {
+    uint64_t tp;
+    asm volatile("mv %0, tp" : "=r"(tp));
+    return (int)tp;
+}
+
+static inline struct cpu *mycpu(void) {
+    return &cpus[cpuid()];
+}
+
+#endif /* __KERNEL_CPU_H__ */
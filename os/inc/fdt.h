@@ -0,0 +1,98 @@
+#ifndef __KERNEL_FDT_H__
+#define __KERNEL_FDT_H__
+
+#include <stdint.h>
+
+// 设备树相关定义
+#define FDT_MAGIC       0xd00dfeed
+#define FDT_BEGIN_NODE  0x1
+#define FDT_END_NODE    0x2
+#define FDT_PROP        0x3
+#define FDT_NOP         0x4
+#define FDT_END         0x9
+
+// 设备树头部结构
+struct fdt_header {
+    uint32_t magic;
+    uint32_t totalsize;
+    uint32_t off_dt_struct;
+    uint32_t off_dt_strings;
+    uint32_t off_mem_rsvmap;
+    uint32_t version;
+    uint32_t last_comp_version;
+    uint32_t boot_cpuid_phys;
+    uint32_t size_dt_strings;
+    uint32_t size_dt_struct;
+};
+
+// 物理内存区间
+struct mem_region {
+    uint64_t base;
+    uint64_t size;
+};
+
+// 字节序转换（FDT为大端）
+static inline uint32_t be32_to_cpu(uint32_t val) {
+    return (val >> 24) | ((val >> 8) & 0xff00) | ((val << 8) & 0xff0000) | (val << 24);
+}
+
+static inline uint64_t be64_to_cpu(uint64_t val) {
+    return ((uint64_t)be32_to_cpu((uint32_t)val) << 32) | be32_to_cpu((uint32_t)(val >> 32));
+}
+
+// 读取由cells个32位大端单元组成的数值
+static inline uint64_t fdt_read_cells(const uint32_t *p, int cells) {
+    uint64_t v = 0;
+    for (int i = 0; i < cells; i++) {
+        v = (v << 32) | be32_to_cpu(p[i]);
+    }
+    return v;
+}
+
+// 索引中的节点，名字指向blob
+struct fdt_node {
+    const char *name;
+    uint32_t path_hash;
+    int32_t parent;
+    int32_t first_child;
+    int32_t next_sibling;
+    uint32_t first_prop;    // 节点属性在属性表中连续存放
+    uint32_t nr_props;
+    uint32_t phandle;
+    uint8_t depth;
+    uint8_t addr_cells;     // 本节点的#address-cells，作用于子节点
+    uint8_t size_cells;
+};
+
+// 索引中的属性，名字和值都指向blob
+struct fdt_prop {
+    const char *name;
+    const void *value;
+    uint32_t len;
+    uint32_t nameoff;
+};
+
+// 一次线性遍历结构块建立索引，arena来自pmm_early_alloc
+int fdt_index_build(uint64_t fdt_addr);
+uint32_t fdt_node_count(void);
+uint32_t fdt_prop_count(void);
+
+// O(1)查询，节点用索引下标表示，找不到返回-1/NULL
+int fdt_find_node(const char *path);
+int fdt_find_phandle(uint32_t phandle);
+const struct fdt_node *fdt_node(int node);
+const void *fdt_getprop(int node, const char *name, uint32_t *lenp);
+const void *fdt_path_getprop(const char *path, const char *name, uint32_t *lenp);
+int fdt_getprop_u32(int node, const char *name, uint32_t *out);
+int fdt_prop_has_string(int node, const char *name, const char *str);
+// 从start之后线性查找compatible匹配的节点（start为-1时从头开始）
+int fdt_find_compatible(int start, const char *compat);
+// 按父节点的cells解析reg属性的第i个区间
+int fdt_get_reg(int node, int i, uint64_t *base, uint64_t *size);
+
+// 收集/memory节点的reg区间，返回区间个数
+int fdt_get_memory(struct mem_region *out, int max);
+// 收集mem_rsvmap与/reserved-memory子节点的区间，返回区间个数
+int fdt_get_reserved(struct mem_region *out, int max);
+
+#endif /* __KERNEL_FDT_H__ */
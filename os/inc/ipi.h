@@ -0,0 +1,28 @@
+#ifndef __KERNEL_IPI_H__
+#define __KERNEL_IPI_H__
+
+#include <stdint.h>
+
+// 跨hart函数调用
+// 每个目标hart一个有界无锁MPSC队列，任意hart可以投递，只有目标hart在软件中断里取出。
+// 每个队列有一个门铃位：投递时门铃从0变1才需要发IPI，目标hart在排空队列前先清门铃，
+// 因此对方还没处理时继续投递的消息不会再产生IPI；一次投递给多个hart时合并成一次SBI调用。
+
+#define IPI_QUEUE_SIZE  64      // 必须是2的幂
+
+typedef void (*ipi_fn_t)(void *arg);
+
+void ipi_init(void);
+
+// 在cpu上执行fn(arg)；目标是自己时直接调用。
+// wait非0时等待执行完毕（等待期间会处理发给自己的消息，不会互相等死）
+void ipi_call(int cpu, ipi_fn_t fn, void *arg, int wait);
+// 在所有在线hart上执行，包括自己，所有远端合并为一次IPI
+void ipi_call_all(ipi_fn_t fn, void *arg, int wait);
+
+// 软件中断处理：排空本hart的队列
+void ipi_handle(void);
+
+void ipi_dump(void);
+
+#endif /* __KERNEL_IPI_H__ */
@@ -0,0 +1,63 @@
+#ifndef __KERNEL_KERNEL_H__
+#define __KERNEL_KERNEL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "memlayout.h"
+
+// 链接脚本导出的符号
+extern char _kernel_start[];
+extern char _end[];
+
+// 构建时生成的启动页表（build/boot_pt.S），boot.S打开分页后使用的就是它
+extern uint64_t boot_page_table[];
+extern const uint64_t boot_pt_stats[4];     // 4K/2M/1G叶子数、页表页数
+
+// 物理地址与内核虚拟地址的换算：低半部分不再有恒等映射，
+// 页分配器、设备树、MMIO都经PAGE_OFFSET起的线性映射访问。
+// __pa只适用于内核镜像中的符号和线性映射区，懒分配区的地址要经页表翻译（va_2_pa_test）
+#define __va(pa)    ((void *)((uint64_t)(pa) + PAGE_OFFSET))
+
+static inline uint64_t __pa(const void *va) {
+    uint64_t a = (uint64_t)va;
+    return a >= KERNEL_VBASE ? a - KERNEL_VBASE + KERNEL_BASE : a - PAGE_OFFSET;
+}
+
+// 输出函数
+void puts(const char *s);
+void print_hex(uint64_t value);
+void print_dec(uint64_t value);
+void panic(const char *msg) __attribute__((noreturn));
+
+// Sv39页表操作（kernel.c）
+uint64_t *pt_alloc(void);
+// 释放level级页表及其下属的中间页表
+void pt_free(uint64_t *table, int level);
+// 只查找不分配：返回level级页表中va对应的PTE，中间页表缺失或被大页覆盖时返回NULL
+uint64_t *pt_walk(uint64_t *root, uint64_t va, int level);
+int map_range(uint64_t *root, uint64_t va, uint64_t pa, uint64_t size, uint64_t perm);
+
+// 软件遍历Sv39页表，支持三级中任意一级的叶子（4K/2M/1G）
+// 成功返回0，info->pa为物理地址；失败返回-1，info中是停下时所在级及其PTE，便于排查缺页
+struct pt_walk_info {
+    uint64_t pa;
+    uint64_t pte;
+    int level;
+};
+
+#define PT_BAD_PA   ((uint64_t)-1)
+
+int pt_translate(const uint64_t *root, uint64_t va, struct pt_walk_info *info);
+// 经过本hart的翻译缓存，未映射返回PT_BAD_PA
+uint64_t va_to_pa(const uint64_t *root, uint64_t va);
+// 修改或删除页表项后调用，使所有hart的翻译缓存失效
+void xlat_cache_invalidate(void);
+
+// 字符串与内存操作
+int strlen(const char *s);
+int strcmp(const char *s1, const char *s2);
+int strncmp(const char *s1, const char *s2, size_t n);
+void *memset(void *dst, int c, size_t n);
+void *memcpy(void *dst, const void *src, size_t n);
+
+#endif /* __KERNEL_KERNEL_H__ */
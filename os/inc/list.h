@@ -0,0 +1,53 @@
+#ifndef __KERNEL_LIST_H__
+#define __KERNEL_LIST_H__
+
+#include <stddef.h>
+
+// 侵入式双向循环链表
+struct list_head {
+    struct list_head *next;
+    struct list_head *prev;
+};
+
+#define container_of(ptr, type, member) \
+    ((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define list_entry(ptr, type, member) container_of(ptr, type, member)
+#define list_first_entry(head, type, member) list_entry((head)->next, type, member)
+
+#define list_for_each(pos, head) \
+    for (pos = (head)->next; pos != (head); pos = pos->next)
+
+static inline void list_init(struct list_head *head) {
+    head->next = head;
+    head->prev = head;
+}
+
+static inline int list_empty(const struct list_head *head) {
+    return head->next == head;
+}
+
+static inline void __list_insert(struct list_head *node, struct list_head *prev,
+                                 struct list_head *next) {
+    node->next = next;
+    node->prev = prev;
+    prev->next = node;
+    next->prev = node;
+}
+
+static inline void list_add(struct list_head *head, struct list_head *node) {
+    __list_insert(node, head, head->next);
+}
+
+static inline void list_add_tail(struct list_head *head, struct list_head *node) {
+    __list_insert(node, head->prev, head);
+}
+
+static inline void list_del(struct list_head *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next = node;
+    node->prev = node;
+}
+
+#endif /* __KERNEL_LIST_H__ */
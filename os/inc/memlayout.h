@@ -0,0 +1,41 @@
+#ifndef __KERNEL_MEMLAYOUT_H__
+#define __KERNEL_MEMLAYOUT_H__
+
+// 内存布局定义
+// 只有常量，内核C代码、boot.S和宿主机上的构建工具（tools/gen_boot_pt.c）共用
+
+#ifdef __ASSEMBLER__
+#define _UL(x)  x
+#else
+#define _UL(x)  x##UL
+#endif
+
+// 内核链接在高地址KERNEL_VBASE，由固件加载到物理地址KERNEL_BASE
+#define KERNEL_BASE     _UL(0x80200000)
+#define KERNEL_VBASE    _UL(0xffffffffc0200000)  // 虚拟地址基址
+#define UART_BASE       _UL(0x10000000)
+#define UART_VBASE      _UL(0xffffffffc0000000)  // UART虚拟地址
+
+// 物理地址[0, DIRECT_MAP_SIZE)线性映射到PAGE_OFFSET起，页分配器返回的都是这一段的地址；
+// 物理内存超过DIRECT_MAP_SIZE时init_mmu在其后补1G叶子，最多到LAZY_VBASE之前
+#define PAGE_OFFSET     _UL(0xffffffc000000000)
+#define DIRECT_MAP_SIZE (_UL(4) << 30)
+
+// 启动页表：构建时生成，放在.boot_pt段，紧跟入口代码之后
+// 链接地址由kernel.ld固定并用ASSERT检查，两边需要同步修改
+#define BOOT_PT_BASE        _UL(0x80201000)
+#define BOOT_PT_MAX_PAGES   8
+
+// 启动页表覆盖的范围：
+//   PAGE_OFFSET起DIRECT_MAP_SIZE      物理内存（及低端MMIO）的线性映射，1G叶子
+//   KERNEL_VBASE起到地址空间顶端       映射到KERNEL_BASE起的物理内存，2M叶子
+//   UART_VBASE                        UART寄存器，一个4K页
+// 另有一张跳板根页表，在此之上恒等映射[0, DIRECT_MAP_SIZE)，
+// 只在各hart打开分页、从物理地址跳到高地址的几条指令期间使用
+#define KERNEL_VMAP_SIZE    ((_UL(1) << 30) - (KERNEL_VBASE & ((_UL(1) << 30) - 1)))
+
+// 按需分配的内核虚拟地址区（vmem.c），1G对齐且不超过1G，只占根页表一项
+#define LAZY_VBASE          _UL(0xffffffd000000000)
+#define LAZY_VSIZE          (_UL(1) << 30)
+
+#endif /* __KERNEL_MEMLAYOUT_H__ */
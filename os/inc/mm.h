@@ -0,0 +1,59 @@
+#ifndef __KERNEL_MM_H__
+#define __KERNEL_MM_H__
+
+#include <stdint.h>
+#include "spinlock.h"
+
+// 地址空间、ASID与TLB批量刷新
+//
+// ASID按代分配：context的低asid_bits位是ASID，高位是分配时的代数。
+// ASID用完时代数加一、清空位图，各hart在下一次切换地址空间时整体刷新一次本地TLB；
+// 翻转时各hart正在使用的ASID保留给原地址空间，它们不必换号。
+// ASID 0固定给内核（init_mm），内核映射带G位，在所有地址空间中共享。
+//
+// 取消映射时把失效范围累积到tlb_batch中，tlb_batch_flush统一处理：
+// 总页数不超过TLB_FLUSH_THRESHOLD时按页刷新，否则刷新整个ASID；
+// 远端只发给用过这个ASID的hart，每批一次sbi_remote_sfence_vma_asid。
+
+#define TLB_BATCH_RANGES        8
+#define TLB_FLUSH_THRESHOLD     32      // 页数
+
+struct mm {
+    uint64_t *root;
+    volatile uint64_t context;      // 代数|ASID，0表示尚未分配
+    volatile uint32_t cpumask;      // 以当前ASID运行过的cpu
+    struct spinlock lock;           // 保护页表修改
+};
+
+struct tlb_batch {
+    struct mm *mm;
+    int nr;
+    uint64_t pages;
+    uint64_t start[TLB_BATCH_RANGES];
+    uint64_t end[TLB_BATCH_RANGES];
+};
+
+extern struct mm init_mm;
+
+// 探测ASID位数，root为内核根页表
+void mm_init(uint64_t *root);
+
+// 新地址空间共享内核映射，私有映射只能位于内核映射之外的1G区间
+struct mm *mm_create(void);
+void mm_destroy(struct mm *mm);
+// 建立映射后向用过这个地址空间的hart刷新[va, va+size)
+int mm_map(struct mm *mm, uint64_t va, uint64_t pa, uint64_t size, uint64_t perm);
+// 清除[va, va+size)内的4K叶子并把范围记入batch，返回清除的页数
+int mm_unmap(struct mm *mm, uint64_t va, uint64_t size, struct tlb_batch *batch);
+
+// 切换本hart的地址空间，调用者已关中断
+void switch_mm(struct mm *mm);
+
+void tlb_batch_init(struct tlb_batch *b, struct mm *mm);
+void tlb_batch_add(struct tlb_batch *b, uint64_t va, uint64_t size);
+void tlb_batch_flush(struct tlb_batch *b);
+
+int mm_asid_bits(void);
+void mm_dump(void);
+
+#endif /* __KERNEL_MM_H__ */
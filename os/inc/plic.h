@@ -0,0 +1,27 @@
+#ifndef __KERNEL_PLIC_H__
+#define __KERNEL_PLIC_H__
+
+#include <stdint.h>
+
+#define PLIC_MAX_IRQ    128
+
+typedef void (*irq_handler_t)(int irq, void *arg);
+
+// 从设备树读取PLIC基址，并为每个已知hart找出其S模式上下文
+int plic_init(void);
+
+#define PLIC_AFFINITY_ALL   0xffffffffU
+
+// 注册中断处理函数，并在当前hart的S模式上下文中使能该中断源
+int plic_register_irq(int irq, irq_handler_t handler, void *arg);
+
+// 设置中断源的亲和性（逻辑cpu位图），在掩码内所有hart的S模式上下文中使能该源；
+// 不存在或没有上下文的cpu被忽略，掩码因此为空时返回-1
+int plic_set_affinity(int irq, uint32_t mask);
+
+// S模式外部中断入口，由trap_handler调用
+void plic_handle_irq(void);
+
+void plic_dump(void);
+
+#endif /* __KERNEL_PLIC_H__ */
@@ -0,0 +1,31 @@
+#ifndef __KERNEL_PMM_H__
+#define __KERNEL_PMM_H__
+
+#include <stdint.h>
+
+// 伙伴系统最大阶：最大块为 2^PMM_MAX_ORDER 页（8MiB）
+#define PMM_MAX_ORDER   11
+
+// 记录FDT位置并开启早期线性分配（pmm_init之前可用）
+void pmm_early_init(uint64_t fdt_addr);
+// 早期线性分配：紧跟内核镜像之后按页分配，pmm_init后不再可用
+void *pmm_early_alloc(uint64_t size);
+
+// 根据设备树/memory与保留区建立伙伴系统
+int pmm_init(void);
+
+// 分配/释放 2^order 个连续物理页，O(log n)
+void *alloc_pages(int order);
+void free_pages(void *addr, int order);
+
+static inline void *alloc_page(void) { return alloc_pages(0); }
+static inline void free_page(void *addr) { free_pages(addr, 0); }
+
+// 已分配块首页的阶，非块首或未分配返回-1
+int pmm_block_order(void *addr);
+
+uint64_t pmm_mem_end(void);
+uint64_t pmm_free_pages(void);
+void pmm_dump(void);
+
+#endif /* __KERNEL_PMM_H__ */
@@ -0,0 +1,47 @@
+#ifndef __KERNEL_PRINTK_H__
+#define __KERNEL_PRINTK_H__
+
+#include <stdint.h>
+
+// 日志级别，数值越小越重要
+#define LOG_EMERG       0
+#define LOG_ERR         3
+#define LOG_WARN        4
+#define LOG_INFO        6
+#define LOG_DEBUG       7
+
+#define LOG_DEFAULT     LOG_INFO
+
+// 每个hart一个日志环，记录定长，行过长时拆成续行记录
+#define LOG_RING_SLOTS  128
+#define LOG_TEXT_MAX    112
+// 单次printk格式化的最大长度，超出截断
+#define PRINTK_FMT_MAX  256
+
+// 高于该级别的消息在入口处直接丢弃
+extern int printk_level;
+
+static inline int printk_enabled(int level) {
+    return level <= printk_level;
+}
+
+// 把文本追加到当前hart的日志行，遇到换行时提交为一条记录
+// printk的格式说明见printf.h
+void printk(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void printk_write(int level, const char *s, int len);
+
+// 把各hart尚未输出的记录按时间戳归并后送往控制台
+// printk_drain在其他hart正在输出时直接返回，适合在空闲循环中调用
+void printk_drain(void);
+void printk_flush(void);
+
+// 按时间顺序重放日志环中仍保留的全部记录（异常后调用）
+void dmesg(void);
+
+// 热路径使用：级别被过滤时连参数都不会求值
+#define pr_err(...)     do { if (printk_enabled(LOG_ERR)) printk(LOG_ERR, __VA_ARGS__); } while (0)
+#define pr_warn(...)    do { if (printk_enabled(LOG_WARN)) printk(LOG_WARN, __VA_ARGS__); } while (0)
+#define pr_info(...)    do { if (printk_enabled(LOG_INFO)) printk(LOG_INFO, __VA_ARGS__); } while (0)
+#define pr_debug(...)   do { if (printk_enabled(LOG_DEBUG)) printk(LOG_DEBUG, __VA_ARGS__); } while (0)
+
+#endif /* __KERNEL_PRINTK_H__ */
@@ -0,0 +1,17 @@
+#ifndef __KERNEL_RELOC_H__
+#define __KERNEL_RELOC_H__
+
+#include <stdint.h>
+
+// 内核自重定位（移植自doc/resolve_symbol.c）
+// 内核以-pie链接，.data中的指针、GOT表项等绝对地址都记录在.rela.dyn里。
+// boot.S打开分页跳到高地址后立即调用relocate_kernel，此时还不能访问任何需要重定位的数据：
+// 这里只用PC相对寻址的局部变量和隐藏可见性的链接脚本符号。
+
+// 处理全部重定位，load_bias = 运行地址 - 链接地址
+void relocate_kernel(uint64_t load_bias);
+
+// 打印重定位统计；有无法处理的条目时panic
+void reloc_dump(void);
+
+#endif /* __KERNEL_RELOC_H__ */
@@ -0,0 +1,107 @@
+#ifndef __KERNEL_RISCV_H__
+#define __KERNEL_RISCV_H__
+
+#include <stdint.h>
+
+// RISC-V CSR寄存器定义
+#define CSR_SSTATUS     0x100
+#define CSR_SIE         0x104
+#define CSR_STVEC       0x105
+#define CSR_SSCRATCH    0x140
+#define CSR_SEPC        0x141
+#define CSR_SCAUSE      0x142
+#define CSR_STVAL       0x143
+#define CSR_SIP         0x144
+#define CSR_SATP        0x180
+#define CSR_STIMECMP    0x14d   // Sstc扩展
+
+// SSTATUS寄存器位定义
+#define SSTATUS_SIE     (1UL << 1)
+#define SSTATUS_SPIE    (1UL << 5)
+#define SSTATUS_SPP     (1UL << 8)
+#define SSTATUS_SUM     (1UL << 18)
+
+// 中断相关定义
+#define IRQ_S_SOFT      1
+#define IRQ_S_TIMER     5
+#define IRQ_S_EXT       9
+#define SCAUSE_INTERRUPT    (1UL << 63)
+#define STVEC_MODE_VECTORED 1UL
+
+// 页表相关定义（Sv39）
+#define SATP_MODE_SV39  (8UL << 60)
+#define SATP_ASID_SHIFT 44
+#define SATP_ASID_MASK  (0xffffUL << SATP_ASID_SHIFT)
+#define PAGE_SHIFT      12
+#define PAGE_SIZE       (1UL << PAGE_SHIFT)
+#define PTE_V           (1UL << 0)   // 有效位
+#define PTE_R           (1UL << 1)   // 读权限
+#define PTE_W           (1UL << 2)   // 写权限
+#define PTE_X           (1UL << 3)   // 执行权限
+#define PTE_U           (1UL << 4)   // 用户模式访问
+#define PTE_G           (1UL << 5)   // 全局映射
+#define PTE_A           (1UL << 6)   // 访问位
+#define PTE_D           (1UL << 7)   // 脏位
+
+#define PTE_PPN_SHIFT   10
+#define PTE_LEAF_MASK   (PTE_R | PTE_W | PTE_X)
+#define PA_TO_PTE(pa)   (((uint64_t)(pa) >> PAGE_SHIFT) << PTE_PPN_SHIFT)
+#define PTE_TO_PA(pte)  (((uint64_t)(pte) >> PTE_PPN_SHIFT) << PAGE_SHIFT)
+#define VPN(va, level)  (((uint64_t)(va) >> (PAGE_SHIFT + 9 * (level))) & 0x1ff)
+#define LEVEL_SIZE(level) (1UL << (PAGE_SHIFT + 9 * (level)))
+
+#define PAGE_ROUND_UP(a)    (((uint64_t)(a) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1))
+#define PAGE_ROUND_DOWN(a)  ((uint64_t)(a) & ~(PAGE_SIZE - 1))
+
+// CSR操作宏：参数先展开再字符串化，既可写csr名也可写CSR_*编号
+#define __csr_str(csr)  #csr
+#define csr_str(csr)    __csr_str(csr)
+
+#define csr_read(csr) ({ \
+    unsigned long __v; \
+    asm volatile("csrr %0, " csr_str(csr) : "=r"(__v) : : "memory"); \
+    __v; \
+})
+
+#define csr_write(csr, val) ({ \
+    asm volatile("csrw " csr_str(csr) ", %0" : : "r"(val) : "memory"); \
+})
+
+#define csr_set(csr, val) ({ \
+    unsigned long __v; \
+    asm volatile("csrrs %0, " csr_str(csr) ", %1" : "=r"(__v) : "r"(val) : "memory"); \
+    __v; \
+})
+
+#define csr_clear(csr, val) ({ \
+    unsigned long __v; \
+    asm volatile("csrrc %0, " csr_str(csr) ", %1" : "=r"(__v) : "r"(val) : "memory"); \
+    __v; \
+})
+
+// 关闭本hart中断并返回之前的SIE状态，不访问内存
+static inline uint64_t local_irq_save(void) {
+    return csr_clear(sstatus, SSTATUS_SIE) & SSTATUS_SIE;
+}
+
+static inline void local_irq_restore(uint64_t flags) {
+    if (flags) {
+        csr_set(sstatus, SSTATUS_SIE);
+    }
+}
+
+// 读取time CSR（各hart共享的时基计数）
+static inline uint64_t rdtime(void) {
+    uint64_t t;
+    asm volatile("rdtime %0" : "=r"(t));
+    return t;
+}
+
+// 64×64位乘积的高64位，乘倒数代替div/rem时用
+static inline uint64_t mulhu(uint64_t a, uint64_t b) {
+    uint64_t hi;
+    asm("mulhu %0, %1, %2" : "=r"(hi) : "r"(a), "r"(b));
+    return hi;
+}
+
+#endif /* __KERNEL_RISCV_H__ */
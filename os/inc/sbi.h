@@ -0,0 +1,79 @@
+#ifndef __KERNEL_SBI_H__
+#define __KERNEL_SBI_H__
+
+#include <stdint.h>
+
+// OpenSBI系统调用接口定义
+#define SBI_SET_TIMER 0
+#define SBI_CONSOLE_PUTCHAR 1
+#define SBI_CONSOLE_GETCHAR 2
+#define SBI_CLEAR_IPI 3
+#define SBI_SEND_IPI 4
+#define SBI_REMOTE_FENCE_I 5
+#define SBI_REMOTE_SFENCE_VMA 6
+#define SBI_REMOTE_SFENCE_VMA_ASID 7
+#define SBI_SHUTDOWN 8
+
+// SBI v0.2+ 扩展ID
+#define SBI_EXT_BASE            0x10
+#define SBI_EXT_TIME            0x54494D45
+#define SBI_EXT_IPI             0x735049
+#define SBI_EXT_RFENCE          0x52464E43
+#define SBI_EXT_HSM             0x48534D
+#define SBI_EXT_SRST            0x53525354
+#define SBI_EXT_DBCN            0x4442434E
+
+// HSM hart状态
+#define SBI_HSM_STARTED         0
+#define SBI_HSM_STOPPED         1
+#define SBI_HSM_START_PENDING   2
+
+// SBI调用结构体
+struct sbiret {
+    long error;
+    long value;
+};
+
+// 内联汇编实现SBI调用
+static inline struct sbiret sbi_ecall(int ext, int fid, unsigned long arg0,
+                                      unsigned long arg1, unsigned long arg2,
+                                      unsigned long arg3, unsigned long arg4,
+                                      unsigned long arg5) {
+    struct sbiret ret;
+    register unsigned long a0 asm("a0") = arg0;
+    register unsigned long a1 asm("a1") = arg1;
+    register unsigned long a2 asm("a2") = arg2;
+    register unsigned long a3 asm("a3") = arg3;
+    register unsigned long a4 asm("a4") = arg4;
+    register unsigned long a5 asm("a5") = arg5;
+    register unsigned long a6 asm("a6") = fid;
+    register unsigned long a7 asm("a7") = ext;
+    
+    asm volatile("ecall"
+                 : "+r"(a0), "+r"(a1)
+                 : "r"(a2), "r"(a3), "r"(a4), "r"(a5), "r"(a6), "r"(a7)
+                 : "memory");
+    
+    ret.error = a0;
+    ret.value = a1;
+    return ret;
+}
+
+// SBI服务接口
+void sbi_console_putchar(int ch);
+struct sbiret sbi_get_spec_version(void);
+struct sbiret sbi_get_impl_id(void);
+struct sbiret sbi_probe_extension(long extension_id);
+void sbi_set_timer(uint64_t stime_value);
+void sbi_shutdown(void);
+struct sbiret sbi_hart_start(uint64_t hartid, uint64_t start_addr, uint64_t opaque);
+struct sbiret sbi_hart_get_status(uint64_t hartid);
+struct sbiret sbi_debug_console_write(uint64_t num_bytes, uint64_t base_addr);
+struct sbiret sbi_send_ipi(uint64_t hart_mask, uint64_t hart_mask_base);
+// size为(uint64_t)-1时刷新整个地址空间
+struct sbiret sbi_remote_sfence_vma(uint64_t hart_mask, uint64_t hart_mask_base,
+                                    uint64_t start, uint64_t size);
+struct sbiret sbi_remote_sfence_vma_asid(uint64_t hart_mask, uint64_t hart_mask_base,
+                                         uint64_t start, uint64_t size, uint64_t asid);
+
+#endif /* __KERNEL_SBI_H__ */
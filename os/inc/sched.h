@@ -0,0 +1,74 @@
+#ifndef __KERNEL_SCHED_H__
+#define __KERNEL_SCHED_H__
+
+#include <stdint.h>
+#include "timer.h"
+
+// 内核线程与调度
+// 每个hart一个运行队列（无锁工作窃取队列），只有本hart在关中断时向自己的队列尾部放入线程，
+// 本hart和其他hart都用CAS从头部取，因此本地是FIFO轮转，空闲hart可以直接窃取。
+// 时间片到期由时钟中断置位need_resched，在最外层中断返回前切换线程。
+
+#define THREAD_STACK_ORDER  2       // 线程栈：16KB
+#define SCHED_SLICE_MS      10
+#define WSQ_SIZE            256     // 每个运行队列的容量，必须是2的幂
+
+enum thread_state {
+    THREAD_RUNNABLE = 0,
+    THREAD_RUNNING,
+    THREAD_BLOCKED,
+    THREAD_EXITING,     // 已调用thread_exit，尚未离开CPU
+    THREAD_ZOMBIE,      // 已离开CPU，等待thread_join回收
+};
+
+// 只保存被调用者保存寄存器，swtch.S按偏移访问
+struct context {
+    uint64_t ra;
+    uint64_t sp;
+    uint64_t s[12];
+};
+
+struct mm;
+
+struct thread {
+    struct context ctx;
+    volatile int state;
+    int tid;
+    const char *name;
+    void (*fn)(void *arg);
+    void *arg;
+    void *stack;
+    int last_cpu;           // 最近一次运行所在的逻辑cpu
+    struct mm *mm;          // 使用的地址空间，NULL表示只用内核映射
+    uint64_t nr_runs;
+    struct timer sleep_timer;
+};
+
+void sched_init(void);
+
+struct thread *thread_create(const char *name, void (*fn)(void *arg), void *arg);
+void thread_exit(void) __attribute__((noreturn));
+// 等待线程结束并回收其栈和描述符，只能在线程中调用
+void thread_join(struct thread *t);
+void sched_yield(void);
+// 让出CPU直到ticks之后，由定时器唤醒
+void thread_sleep(uint64_t ticks);
+
+// 切换当前线程的地址空间，NULL回到内核地址空间
+void thread_set_mm(struct mm *mm);
+
+// 当前hart正在运行的线程，在调度器或初始化代码中为NULL
+struct thread *sched_current(void);
+
+// 进入本hart的调度循环，不再返回
+void sched_run(void) __attribute__((noreturn));
+void sched_dump(void);
+
+// 由boot.S的中断出口调用
+int sched_preempt_check(void);
+void sched_preempt(void);
+
+// swtch.S
+void swtch(struct context *old, struct context *new);
+
+#endif /* __KERNEL_SCHED_H__ */
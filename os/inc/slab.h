@@ -0,0 +1,24 @@
+#ifndef __KERNEL_SLAB_H__
+#define __KERNEL_SLAB_H__
+
+#include <stddef.h>
+
+struct kmem_cache;
+
+// 基于页分配器的对象缓存；每个hart有独立的magazine，常见路径无锁
+void kmalloc_init(void);
+
+struct kmem_cache *kmem_cache_create(const char *name, size_t size);
+void *kmem_cache_alloc(struct kmem_cache *cache);
+void kmem_cache_free(struct kmem_cache *cache, void *obj);
+
+// 通用分配：小对象走尺寸分级缓存，超过KMALLOC_MAX_SIZE直接分配整页
+#define KMALLOC_MAX_SIZE    1024
+void *kmalloc(size_t size);
+void *kzalloc(size_t size);
+void kfree(void *ptr);
+
+// 在控制台打印各缓存的统计信息
+void kmem_dump(void);
+
+#endif /* __KERNEL_SLAB_H__ */
@@ -0,0 +1,19 @@
+#ifndef __KERNEL_SMP_H__
+#define __KERNEL_SMP_H__
+
+#include <stdint.h>
+
+// 每个从核的内核栈：2^KSTACK_ORDER页
+#define KSTACK_ORDER    2
+
+// 启动hart调用：从设备树/cpus节点发现其余hart并通过SBI HSM启动
+void smp_init(uint64_t boot_hartid);
+
+// 物理hart ID -> 逻辑编号，找不到返回-1
+int hartid_to_cpu(uint64_t hartid);
+
+// 从逻辑cpu位图中取出一组能用同一个hart_mask_base表示的hart（SBI的hart_mask只有64位），
+// 返回hart_mask并把已取出的cpu从*cpumask中清除；*cpumask为0时结束
+uint64_t cpumask_next_harts(uint32_t *cpumask, uint64_t *base);
+
+#endif /* __KERNEL_SMP_H__ */
@@ -0,0 +1,25 @@
+#ifndef __KERNEL_SPINLOCK_H__
+#define __KERNEL_SPINLOCK_H__
+
+#include <stdint.h>
+#include "lock.h"
+
+// 自旋锁：排号锁（common/lock.h）加上关本hart中断，持锁期间不会被抢占
+struct spinlock {
+    struct ticket_lock lock;
+    int cpu;        // 持有者，调试用
+};
+
+#define SPINLOCK_INIT(n) { TICKET_LOCK_INIT(n), -1 }
+
+void spin_lock_init(struct spinlock *lk, const char *name);
+void spin_lock(struct spinlock *lk);
+// 获取失败立即返回0，成功返回1
+int spin_trylock(struct spinlock *lk);
+void spin_unlock(struct spinlock *lk);
+
+// 可嵌套的关中断，与pop_off成对使用
+void push_off(void);
+void pop_off(void);
+
+#endif /* __KERNEL_SPINLOCK_H__ */
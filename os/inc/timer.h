@@ -0,0 +1,60 @@
+#ifndef __KERNEL_TIMER_H__
+#define __KERNEL_TIMER_H__
+
+#include <stdint.h>
+#include "list.h"
+
+// 分级时间轮
+// 每个hart一个时间轮，4级×64槽，每级槽宽是上一级的64倍。
+// 第0级槽宽为一个时间单位（约1ms，取2的幂个tick，换算只需移位）。
+// 插入、取消都是O(1)；到期的定时器在时钟中断里回调。
+// 硬件截止时间只设为最早的到期时间（tickless），没有定时器的hart不会收到时钟中断。
+
+#define TW_LEVELS       4
+#define TW_SLOT_BITS    6
+#define TW_SLOTS        (1 << TW_SLOT_BITS)
+
+struct timer;
+typedef void (*timer_fn_t)(struct timer *t);
+
+struct timer {
+    struct list_head entry;
+    uint64_t expires;           // 到期时间（rdtime tick）
+    uint64_t unit;              // 到期时间换算成的时间单位（向上取整）
+    timer_fn_t fn;
+    void *data;
+    struct timer_wheel *wheel;  // 所在时间轮，未挂入时为NULL
+    uint8_t level;
+    uint8_t slot;
+};
+
+extern uint64_t timebase_freq;
+
+// 读取/cpus的timebase-frequency并初始化各hart的时间轮
+void timer_init(void);
+
+void timer_setup(struct timer *t, timer_fn_t fn, void *data);
+// 在当前hart的时间轮上挂入定时器，expires为绝对时间（tick）；已挂入的会先取消
+void timer_add(struct timer *t, uint64_t expires);
+// 取消定时器，返回1表示取消前仍在等待；回调已开始执行时返回0
+int timer_cancel(struct timer *t);
+
+static inline int timer_pending(const struct timer *t) {
+    return t->wheel != NULL;
+}
+
+uint64_t us_to_ticks(uint64_t us);
+// 把tick拆成秒和微秒，用预先算好的倒数，不做除法；printk每条记录都要换算
+void ticks_to_sec_us(uint64_t ticks, uint64_t *sec, uint64_t *usec);
+uint64_t ms_to_ticks(uint64_t ms);
+
+// 睡眠期间本hart执行wfi，由定时器中断唤醒；在内核线程中调用时改为让出CPU
+void usleep(uint64_t us);
+void msleep(uint64_t ms);
+// 不足一个时间单位的短延时忙等rdtime，更长的转为睡眠
+void udelay(uint64_t us);
+
+// 由时钟中断入口调用
+void timer_interrupt(void);
+
+#endif /* __KERNEL_TIMER_H__ */
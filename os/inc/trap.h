@@ -0,0 +1,62 @@
+#ifndef __KERNEL_TRAP_H__
+#define __KERNEL_TRAP_H__
+
+#include <stdint.h>
+
+// 陷入处理
+// stvec使用向量模式：中断按原因号跳到各自的入口，同步异常统一进入trap_exception。
+// 陷入帧不放在被打断的栈上，而是放在每个hart自己的陷入栈上，sscratch指向栈顶；
+// 进入处理函数后sscratch清零，嵌套陷入据此直接在陷入栈上继续压帧。
+//
+// 中断只保存调用者保存寄存器（ra/t*/a*），处理函数是普通C函数，
+// 被调用者保存寄存器由编译器保证不变；中断处理函数必须在关中断状态下运行完，
+// 期间不能再产生异常，也不能打开中断。
+// 同步异常保存完整的trap_frame，处理函数可以读写其中的寄存器和sepc。
+
+#define TRAP_STACK_ORDER    1       // 每个hart的陷入栈：8KB
+
+// 同步异常原因（scause，最高位为0）
+#define EXC_INST_MISALIGNED     0
+#define EXC_INST_ACCESS         1
+#define EXC_ILLEGAL_INST        2
+#define EXC_BREAKPOINT          3
+#define EXC_LOAD_MISALIGNED     4
+#define EXC_LOAD_ACCESS         5
+#define EXC_STORE_MISALIGNED    6
+#define EXC_STORE_ACCESS        7
+#define EXC_ECALL_U             8
+#define EXC_ECALL_S             9
+#define EXC_INST_PAGE_FAULT     12
+#define EXC_LOAD_PAGE_FAULT     13
+#define EXC_STORE_PAGE_FAULT    15
+#define EXC_MAX                 16
+
+// boot.S按偏移访问，修改布局时需同步
+struct trap_frame {
+    uint64_t regs[32];      // x0~x31，regs[2]为被打断时的sp
+    uint64_t sepc;
+    uint64_t sstatus;
+    uint64_t scause;
+    uint64_t stval;
+    uint64_t sscratch;      // 返回时写回sscratch：外层为陷入栈顶，嵌套为0
+    uint64_t pad;
+};
+
+_Static_assert(sizeof(struct trap_frame) == 38 * 8, "trap_frame layout is shared with boot.S");
+
+// 返回0表示已处理，从tf->sepc继续执行；非0则按致命异常处理
+typedef int (*exception_handler_t)(struct trap_frame *tf);
+
+// 分配本hart的陷入栈，设置sscratch与向量模式的stvec并打开中断
+void trap_init_hart(void);
+
+// 为某个同步异常原因注册处理函数
+void trap_set_handler(int cause, exception_handler_t handler);
+
+// 以下由boot.S的入口调用
+void trap_handler(struct trap_frame *tf);
+void irq_soft_handler(void);
+void irq_timer_handler(void);
+void irq_external_handler(void);
+
+#endif /* __KERNEL_TRAP_H__ */
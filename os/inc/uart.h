@@ -0,0 +1,23 @@
+#ifndef __KERNEL_UART_H__
+#define __KERNEL_UART_H__
+
+#include <stdint.h>
+
+// 中断驱动的ns16550 UART驱动
+#define UART_TX_RING_SIZE   4096
+#define UART_RX_RING_SIZE   256
+
+// 从设备树找到UART，初始化并通过PLIC注册中断
+int uart_init(void);
+
+// 写入发送环形缓冲，不等待线路；由THRE中断搬运到FIFO
+void uart_write(const char *s, int len);
+// 轮询方式直接输出，仅用于panic
+void uart_write_sync(const char *s, int len);
+// 等待发送缓冲全部发出（关机前使用）
+void uart_drain(void);
+
+// 从接收环形缓冲读取一个字符，没有数据时返回-1
+int uart_getc(void);
+
+#endif /* __KERNEL_UART_H__ */
@@ -0,0 +1,33 @@
+#ifndef __KERNEL_VMEM_H__
+#define __KERNEL_VMEM_H__
+
+#include <stdint.h>
+
+// 按需分配的内核虚拟内存
+// [LAZY_VBASE, LAZY_VBASE+LAZY_VSIZE)只预留不映射，vmem_alloc从中划出区域并登记。
+// 区域内的页第一次被访问时触发读/写缺页，处理函数分配一个清零的物理页映射上去，
+// sret后重新执行访存指令；没有访问过的页不占物理内存，预留本身也不花启动时间。
+// 区域下方留一个不登记的保护页，栈溢出等越界访问落在保护页上，按致命异常处理。
+// 缺页处理要获取vmem_lock和pmm的锁，只有不会在持有这两把锁时访问的数据（如大块缓冲区）才能懒分配；
+// 线程栈用vmem_populate预先分配，只借用区域下方的保护页。
+// 根页表中这一段对应的L1页表在vmem_init时建好，之后创建的地址空间复制根页表时一并共享。
+// 懒分配区只可读写，取指缺页不处理；其中的地址不是恒等映射，交给SBI等需要物理地址的接口前要先翻译。
+
+#define VMEM_MAX_REGIONS    64
+
+// 在init_mmu之后、创建任何用户地址空间之前调用；注册缺页处理函数
+void vmem_init(void);
+
+// 预留size字节（按页取整），返回页对齐的内核虚拟地址，失败返回NULL
+void *vmem_alloc(uint64_t size, const char *name);
+
+// 立即为[addr, addr+size)分配并映射物理页，之后访问不再缺页；失败返回-1，已映射的页留在区域内。
+// 缺页处理要获取vmem_lock和pmm的锁，可能在持有这些锁时被访问的内存（例如线程栈）必须预先分配
+int vmem_populate(void *addr, uint64_t size);
+
+// 释放整个区域：解除映射、刷新所有hart的TLB并归还物理页
+void vmem_free(void *addr);
+
+void vmem_dump(void);
+
+#endif /* __KERNEL_VMEM_H__ */
@@ -0,0 +1,89 @@
+#include "kernel.h"
+#include "riscv.h"
+#include "sbi.h"
+#include "console.h"
+#include "printk.h"
+#include "uart.h"
+
+// 控制台输出
+// 日志由printk按整行记录交给这里，每条记录只调用一次后端：
+// DBCN后端一次ecall写整段；不支持DBCN时退回逐字节的legacy接口。
+// UART驱动初始化后改用CONSOLE_UART，整行写入发送环形缓冲，由THRE中断送上线路。
+
+static enum console_backend backend = CONSOLE_SBI_LEGACY;
+
+// DBCN要的是物理地址：内核镜像和线性映射可以直接换算。printk的拼行缓冲
+// 在内核镜像里，总能走DBCN；懒分配区（线程栈）的页在物理上不连续，
+// 调用者传来这样的地址时只能退回逐字节输出
+static int dbcn_addr_ok(const char *s) {
+    uint64_t va = (uint64_t)s;
+    return va >= KERNEL_VBASE || (va >= PAGE_OFFSET && va < LAZY_VBASE);
+}
+
+static void sbi_emit(const char *s, int len) {
+    if (backend == CONSOLE_SBI_DBCN && dbcn_addr_ok(s)) {
+        while (len > 0) {
+            struct sbiret ret = sbi_debug_console_write(len, __pa(s));
+            if (ret.error != 0) {
+                break;
+            }
+            s += ret.value;
+            len -= ret.value;
+        }
+        if (len == 0) {
+            return;
+        }
+    }
+
+    while (len-- > 0) {
+        sbi_console_putchar(*s++);
+    }
+}
+
+void console_init(void) {
+    struct sbiret ret = sbi_probe_extension(SBI_EXT_DBCN);
+
+    if (ret.error == 0 && ret.value != 0) {
+        backend = CONSOLE_SBI_DBCN;
+    }
+}
+
+enum console_backend console_get_backend(void) {
+    return backend;
+}
+
+void console_set_backend(enum console_backend b) {
+    printk_flush();
+    backend = b;
+}
+
+void console_write(const char *s, int len) {
+    if (backend == CONSOLE_UART) {
+        uart_write(s, len);
+    } else {
+        sbi_emit(s, len);
+    }
+}
+
+// panic时不能依赖中断和锁，UART后端改为轮询直接写寄存器
+void console_write_sync(const char *s, int len) {
+    if (backend == CONSOLE_UART) {
+        uart_write_sync(s, len);
+    } else {
+        sbi_emit(s, len);
+    }
+}
+
+void console_sync(void) {
+    printk_flush();
+    if (backend == CONSOLE_UART) {
+        uart_drain();
+    }
+}
+
+int console_getc(void) {
+    if (backend == CONSOLE_UART) {
+        return uart_getc();
+    }
+    return -1;
+}
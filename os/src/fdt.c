@@ -0,0 +1,473 @@
+#include "kernel.h"
+#include "fdt.h"
+#include "pmm.h"
+
+// 设备树索引
+// 对结构块做一次线性遍历，建立节点表、属性表以及三张开放寻址哈希表：
+//   节点路径哈希 -> 节点，phandle -> 节点，(节点, 属性名偏移) -> 属性。
+// 属性名先经字符串哈希映射为字符串块中的偏移，之后只比较整数。
+// 返回给调用者的名字和属性值都直接指向blob，不做拷贝。
+// 全部表放在一块按size_dt_struct估算的arena中：每个节点或属性在结构块中
+// 至少占12字节，因此条目数不会超过size_dt_struct / 12。
+
+#define FDT_MAX_DEPTH   16
+#define FDT_MIN_ENTRY   12
+#define FDT_ALIGN4(x)   (((x) + 3) & ~3U)
+
+#define FNV_OFFSET      2166136261U
+#define FNV_PRIME       16777619U
+
+struct fdt_index {
+    const char *blob;
+    const char *strings;
+    struct fdt_node *nodes;
+    struct fdt_prop *props;
+    uint32_t *node_hash;    // 槽内存放 节点下标+1，0为空
+    uint32_t *phandle_hash;
+    uint32_t *prop_hash;    // 槽内存放 属性下标+1
+    uint32_t *name_hash;    // 槽内存放 字符串偏移+1
+    uint32_t hash_mask;
+    uint32_t cap;
+    uint32_t nr_nodes;
+    uint32_t nr_props;
+};
+
+static struct fdt_index idx;
+
+static inline uint32_t fnv_step(uint32_t h, char c) {
+    return (h ^ (uint8_t)c) * FNV_PRIME;
+}
+
+static uint32_t fnv_str(uint32_t h, const char *s, int n) {
+    for (int i = 0; i < n; i++) {
+        h = fnv_step(h, s[i]);
+    }
+    return h;
+}
+
+static inline uint32_t mix32(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x7feb352d;
+    h ^= h >> 15;
+    h *= 0x846ca68b;
+    h ^= h >> 16;
+    return h;
+}
+
+static inline uint32_t prop_key(uint32_t node, uint32_t nameoff) {
+    return mix32(node * 0x9e3779b1U ^ nameoff);
+}
+
+static inline int fdt_node_is(const char *name, const char *base) {
+    int n = strlen(base);
+    return strncmp(name, base, n) == 0 && (name[n] == '\0' || name[n] == '@');
+}
+
+// 字符串块偏移去重：相同属性名只登记一次，返回该名字的规范偏移
+static uint32_t name_insert(uint32_t nameoff) {
+    const char *name = idx.strings + nameoff;
+    uint32_t h = fnv_str(FNV_OFFSET, name, strlen(name));
+
+    for (uint32_t i = h & idx.hash_mask;; i = (i + 1) & idx.hash_mask) {
+        uint32_t slot = idx.name_hash[i];
+        if (slot == 0) {
+            idx.name_hash[i] = nameoff + 1;
+            return nameoff;
+        }
+        if (slot - 1 == nameoff || strcmp(idx.strings + slot - 1, name) == 0) {
+            return slot - 1;
+        }
+    }
+}
+
+// 属性名 -> 字符串块偏移，未出现过的名字返回-1
+static int64_t name_lookup(const char *name) {
+    uint32_t h = fnv_str(FNV_OFFSET, name, strlen(name));
+
+    for (uint32_t i = h & idx.hash_mask;; i = (i + 1) & idx.hash_mask) {
+        uint32_t slot = idx.name_hash[i];
+        if (slot == 0) {
+            return -1;
+        }
+        if (strcmp(idx.strings + slot - 1, name) == 0) {
+            return slot - 1;
+        }
+    }
+}
+
+static void hash_insert(uint32_t *table, uint32_t key, uint32_t value) {
+    uint32_t i = key & idx.hash_mask;
+    while (table[i] != 0) {
+        i = (i + 1) & idx.hash_mask;
+    }
+    table[i] = value + 1;
+}
+
+int fdt_index_build(uint64_t fdt_addr) {
+    const struct fdt_header *fdt = (const struct fdt_header *)fdt_addr;
+    if (be32_to_cpu(fdt->magic) != FDT_MAGIC) {
+        return -1;
+    }
+
+    uint32_t size_struct = be32_to_cpu(fdt->size_dt_struct);
+    uint32_t cap = size_struct / FDT_MIN_ENTRY + 1;
+    uint32_t hsize = 16;
+    while (hsize < cap * 2) {
+        hsize <<= 1;
+    }
+
+    uint64_t hash_bytes = (uint64_t)hsize * sizeof(uint32_t);
+    uint64_t bytes = cap * sizeof(struct fdt_node) + cap * sizeof(struct fdt_prop) +
+                     4 * hash_bytes;
+    char *arena = pmm_early_alloc(bytes);
+    if (arena == NULL) {
+        return -1;
+    }
+
+    idx.blob = (const char *)fdt_addr;
+    idx.strings = idx.blob + be32_to_cpu(fdt->off_dt_strings);
+    idx.nodes = (struct fdt_node *)arena;
+    idx.props = (struct fdt_prop *)(arena + cap * sizeof(struct fdt_node));
+    idx.node_hash = (uint32_t *)(idx.props + cap);
+    idx.phandle_hash = idx.node_hash + hsize;
+    idx.prop_hash = idx.phandle_hash + hsize;
+    idx.name_hash = idx.prop_hash + hsize;
+    idx.hash_mask = hsize - 1;
+    idx.cap = cap;
+    idx.nr_nodes = 0;
+    idx.nr_props = 0;
+    memset(idx.node_hash, 0, 4 * hash_bytes);
+
+    const uint8_t *p = (const uint8_t *)idx.blob + be32_to_cpu(fdt->off_dt_struct);
+    const uint8_t *end = p + size_struct;
+    int32_t stack[FDT_MAX_DEPTH];
+    int32_t last_child[FDT_MAX_DEPTH];
+    int depth = -1;
+
+    while (p < end) {
+        uint32_t tag = be32_to_cpu(*(const uint32_t *)p);
+        p += 4;
+
+        switch (tag) {
+        case FDT_BEGIN_NODE: {
+            const char *name = (const char *)p;
+            int namelen = strlen(name);
+            p += FDT_ALIGN4(namelen + 1);
+            if (depth + 1 >= FDT_MAX_DEPTH || idx.nr_nodes >= cap) {
+                return -1;
+            }
+
+            uint32_t n = idx.nr_nodes++;
+            struct fdt_node *node = &idx.nodes[n];
+            int32_t parent = depth >= 0 ? stack[depth] : -1;
+
+            node->name = name;
+            node->parent = parent;
+            node->first_child = -1;
+            node->next_sibling = -1;
+            node->first_prop = idx.nr_props;
+            node->nr_props = 0;
+            node->phandle = 0;
+            node->depth = depth + 1;
+            node->addr_cells = 2;
+            node->size_cells = 1;
+
+            // 路径哈希在父节点基础上增量计算，根节点路径记为空串
+            if (parent < 0) {
+                node->path_hash = FNV_OFFSET;
+            } else {
+                node->path_hash = fnv_str(fnv_step(idx.nodes[parent].path_hash, '/'),
+                                          name, namelen);
+                if (last_child[depth] < 0) {
+                    idx.nodes[parent].first_child = n;
+                } else {
+                    idx.nodes[last_child[depth]].next_sibling = n;
+                }
+                last_child[depth] = n;
+            }
+            hash_insert(idx.node_hash, mix32(node->path_hash), n);
+
+            stack[++depth] = n;
+            last_child[depth] = -1;
+            break;
+        }
+        case FDT_END_NODE:
+            if (depth < 0) {
+                return -1;
+            }
+            depth--;
+            break;
+        case FDT_PROP: {
+            uint32_t len = be32_to_cpu(((const uint32_t *)p)[0]);
+            uint32_t rawoff = be32_to_cpu(((const uint32_t *)p)[1]);
+            const uint32_t *val = (const uint32_t *)(p + 8);
+            p += 8 + FDT_ALIGN4(len);
+            if (depth < 0 || idx.nr_props >= cap) {
+                return -1;
+            }
+
+            uint32_t n = stack[depth];
+            uint32_t pi = idx.nr_props++;
+            struct fdt_node *node = &idx.nodes[n];
+            const char *name = idx.strings + rawoff;
+            uint32_t nameoff = name_insert(rawoff);
+
+            // 节点的属性总在子节点之前出现，因此在props[]中连续
+            idx.props[pi].name = name;
+            idx.props[pi].value = val;
+            idx.props[pi].len = len;
+            idx.props[pi].nameoff = nameoff;
+            node->nr_props++;
+
+            hash_insert(idx.prop_hash, prop_key(n, nameoff), pi);
+
+            if (len == 4) {
+                if (strcmp(name, "phandle") == 0 || strcmp(name, "linux,phandle") == 0) {
+                    node->phandle = be32_to_cpu(val[0]);
+                    hash_insert(idx.phandle_hash, mix32(node->phandle), n);
+                } else if (strcmp(name, "#address-cells") == 0) {
+                    node->addr_cells = be32_to_cpu(val[0]);
+                } else if (strcmp(name, "#size-cells") == 0) {
+                    node->size_cells = be32_to_cpu(val[0]);
+                }
+            }
+            break;
+        }
+        case FDT_NOP:
+            break;
+        case FDT_END:
+            return depth == -1 ? 0 : -1;
+        default:
+            return -1;
+        }
+    }
+    return -1;
+}
+
+uint32_t fdt_node_count(void) {
+    return idx.nr_nodes;
+}
+
+uint32_t fdt_prop_count(void) {
+    return idx.nr_props;
+}
+
+const struct fdt_node *fdt_node(int node) {
+    if (node < 0 || (uint32_t)node >= idx.nr_nodes) {
+        return NULL;
+    }
+    return &idx.nodes[node];
+}
+
+// 从路径末尾逐级向上比较节点名
+static int path_matches(int node, const char *path, int len) {
+    while (node > 0) {
+        int slash = len - 1;
+        while (slash >= 0 && path[slash] != '/') {
+            slash--;
+        }
+        if (slash < 0) {
+            return 0;
+        }
+        const char *comp = path + slash + 1;
+        int clen = len - slash - 1;
+        const char *name = idx.nodes[node].name;
+        if (strncmp(name, comp, clen) != 0 || name[clen] != '\0') {
+            return 0;
+        }
+        node = idx.nodes[node].parent;
+        len = slash;
+    }
+    return node == 0 && len == 0;
+}
+
+int fdt_find_node(const char *path) {
+    if (idx.nr_nodes == 0 || path[0] != '/') {
+        return -1;
+    }
+    if (path[1] == '\0') {
+        return 0;
+    }
+
+    int len = strlen(path);
+    uint32_t h = mix32(fnv_str(FNV_OFFSET, path, len));
+
+    for (uint32_t i = h & idx.hash_mask;; i = (i + 1) & idx.hash_mask) {
+        uint32_t slot = idx.node_hash[i];
+        if (slot == 0) {
+            return -1;
+        }
+        int n = slot - 1;
+        if (mix32(idx.nodes[n].path_hash) == h && path_matches(n, path, len)) {
+            return n;
+        }
+    }
+}
+
+int fdt_find_phandle(uint32_t phandle) {
+    if (idx.nr_nodes == 0 || phandle == 0) {
+        return -1;
+    }
+
+    for (uint32_t i = mix32(phandle) & idx.hash_mask;; i = (i + 1) & idx.hash_mask) {
+        uint32_t slot = idx.phandle_hash[i];
+        if (slot == 0) {
+            return -1;
+        }
+        if (idx.nodes[slot - 1].phandle == phandle) {
+            return slot - 1;
+        }
+    }
+}
+
+const void *fdt_getprop(int node, const char *name, uint32_t *lenp) {
+    if (node < 0 || (uint32_t)node >= idx.nr_nodes) {
+        return NULL;
+    }
+
+    int64_t nameoff = name_lookup(name);
+    if (nameoff < 0) {
+        return NULL;
+    }
+
+    for (uint32_t i = prop_key(node, nameoff) & idx.hash_mask;; i = (i + 1) & idx.hash_mask) {
+        uint32_t slot = idx.prop_hash[i];
+        if (slot == 0) {
+            return NULL;
+        }
+        const struct fdt_prop *pr = &idx.props[slot - 1];
+        uint32_t first = idx.nodes[node].first_prop;
+        if (pr->nameoff == nameoff && slot - 1 >= first &&
+            slot - 1 < first + idx.nodes[node].nr_props) {
+            if (lenp) {
+                *lenp = pr->len;
+            }
+            return pr->value;
+        }
+    }
+}
+
+const void *fdt_path_getprop(const char *path, const char *name, uint32_t *lenp) {
+    return fdt_getprop(fdt_find_node(path), name, lenp);
+}
+
+int fdt_getprop_u32(int node, const char *name, uint32_t *out) {
+    uint32_t len;
+    const uint32_t *val = fdt_getprop(node, name, &len);
+
+    if (val == NULL || len < 4) {
+        return -1;
+    }
+    *out = be32_to_cpu(val[0]);
+    return 0;
+}
+
+// 字符串列表属性（以\0分隔）中是否包含str
+int fdt_prop_has_string(int node, const char *name, const char *str) {
+    uint32_t len;
+    const char *p = fdt_getprop(node, name, &len);
+
+    if (p == NULL) {
+        return 0;
+    }
+    const char *end = p + len;
+    while (p < end) {
+        if (strcmp(p, str) == 0) {
+            return 1;
+        }
+        p += strlen(p) + 1;
+    }
+    return 0;
+}
+
+// 按compatible查找节点：从start之后的节点开始线性查找，只用于驱动初始化
+int fdt_find_compatible(int start, const char *compat) {
+    for (uint32_t n = start + 1; n < idx.nr_nodes; n++) {
+        if (fdt_prop_has_string(n, "compatible", compat)) {
+            return n;
+        }
+    }
+    return -1;
+}
+
+int fdt_get_reg(int node, int i, uint64_t *base, uint64_t *size) {
+    const struct fdt_node *n = fdt_node(node);
+    if (n == NULL || n->parent < 0) {
+        return -1;
+    }
+
+    const struct fdt_node *parent = &idx.nodes[n->parent];
+    uint32_t len;
+    const uint32_t *reg = fdt_getprop(node, "reg", &len);
+    uint32_t stride = (parent->addr_cells + parent->size_cells) * 4;
+
+    if (reg == NULL || stride == 0 || (uint32_t)(i + 1) * stride > len) {
+        return -1;
+    }
+    reg += i * stride / 4;
+    *base = fdt_read_cells(reg, parent->addr_cells);
+    if (size) {
+        *size = fdt_read_cells(reg + parent->addr_cells, parent->size_cells);
+    }
+    return 0;
+}
+
+// 把节点全部reg区间追加到out中
+static int collect_reg(int node, struct mem_region *out, int count, int max) {
+    uint64_t base, size;
+
+    for (int i = 0; count < max && fdt_get_reg(node, i, &base, &size) == 0; i++) {
+        if (size != 0) {
+            out[count].base = base;
+            out[count].size = size;
+            count++;
+        }
+    }
+    return count;
+}
+
+int fdt_get_memory(struct mem_region *out, int max) {
+    int count = 0;
+
+    if (idx.nr_nodes == 0) {
+        return -1;
+    }
+    for (int n = idx.nodes[0].first_child; n >= 0; n = idx.nodes[n].next_sibling) {
+        const char *type = fdt_getprop(n, "device_type", NULL);
+        if (fdt_node_is(idx.nodes[n].name, "memory") ||
+            (type && strcmp(type, "memory") == 0)) {
+            count = collect_reg(n, out, count, max);
+        }
+    }
+    return count;
+}
+
+int fdt_get_reserved(struct mem_region *out, int max) {
+    const struct fdt_header *fdt = (const struct fdt_header *)idx.blob;
+    int count = 0;
+
+    if (idx.nr_nodes == 0) {
+        return -1;
+    }
+
+    // 内存保留块：以size为0的条目结束
+    const uint64_t *rsv = (const uint64_t *)(idx.blob + be32_to_cpu(fdt->off_mem_rsvmap));
+    for (; count < max; rsv += 2) {
+        uint64_t base = be64_to_cpu(rsv[0]);
+        uint64_t size = be64_to_cpu(rsv[1]);
+        if (size == 0) {
+            break;
+        }
+        out[count].base = base;
+        out[count].size = size;
+        count++;
+    }
+
+    int resv = fdt_find_node("/reserved-memory");
+    if (resv >= 0) {
+        for (int n = idx.nodes[resv].first_child; n >= 0; n = idx.nodes[n].next_sibling) {
+            count = collect_reg(n, out, count, max);
+        }
+    }
+    return count;
+}
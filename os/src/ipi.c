@@ -0,0 +1,194 @@
+#include "kernel.h"
+#include "riscv.h"
+#include "sbi.h"
+#include "cpu.h"
+#include "smp.h"
+#include "atomic.h"
+#include "printk.h"
+#include "ipi.h"
+
+// 有界MPSC队列：每个槽位带序号，槽位空闲时seq == 位置，写满后seq == 位置 + 1。
+// 投递者用CAS抢占head上的位置，写好槽位后以释放语义发布seq；
+// 目标hart按tail顺序读，取完把seq推进一整圈，槽位即可被下一轮复用。
+// 位置用32位计数，比较时取有符号差值，回绕不影响判断。
+
+struct ipi_sync {
+    volatile uint32_t pending;
+};
+
+struct ipi_slot {
+    volatile uint32_t seq;
+    ipi_fn_t fn;
+    void *arg;
+    struct ipi_sync *sync;
+};
+
+struct ipi_queue {
+    volatile uint32_t head;             // 投递端，多个hart竞争
+    uint32_t pad0[15];
+    uint32_t tail;                      // 只有目标hart访问
+    volatile uint32_t doorbell;         // 1：已经发过IPI，目标尚未开始排空
+    uint64_t nr_msgs;
+    uint64_t nr_irqs;
+    uint64_t max_batch;
+    volatile uint64_t nr_rings;         // 门铃从0变1的次数（由投递者累加）
+    struct ipi_slot slots[IPI_QUEUE_SIZE];
+} __attribute__((aligned(64)));
+
+static struct ipi_queue ipi_queues[NCPU];
+
+void ipi_init(void) {
+    for (int c = 0; c < NCPU; c++) {
+        for (uint32_t i = 0; i < IPI_QUEUE_SIZE; i++) {
+            ipi_queues[c].slots[i].seq = i;
+        }
+    }
+}
+
+// 队列满时返回0
+static int ipi_enqueue(struct ipi_queue *q, ipi_fn_t fn, void *arg, struct ipi_sync *sync) {
+    uint32_t pos = q->head;
+
+    for (;;) {
+        struct ipi_slot *slot = &q->slots[pos & (IPI_QUEUE_SIZE - 1)];
+        int32_t diff = (int32_t)(load_acquire32(&slot->seq) - pos);
+
+        if (diff == 0) {
+            if (atomic_cas32(&q->head, pos, pos + 1)) {
+                slot->fn = fn;
+                slot->arg = arg;
+                slot->sync = sync;
+                store_release32(&slot->seq, pos + 1);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0;
+        }
+        pos = q->head;
+    }
+}
+
+// 只由目标hart调用；取完一个消息返回1
+static int ipi_dequeue(struct ipi_queue *q, struct ipi_slot *out) {
+    struct ipi_slot *slot = &q->slots[q->tail & (IPI_QUEUE_SIZE - 1)];
+
+    if (load_acquire32(&slot->seq) != q->tail + 1) {
+        return 0;
+    }
+    out->fn = slot->fn;
+    out->arg = slot->arg;
+    out->sync = slot->sync;
+    store_release32(&slot->seq, q->tail + IPI_QUEUE_SIZE);
+    q->tail++;
+    return 1;
+}
+
+void ipi_handle(void) {
+    struct ipi_queue *q = &ipi_queues[cpuid()];
+    struct ipi_slot msg;
+    uint64_t batch = 0;
+
+    // 先清门铃再排空：之后投递的消息要么在本轮被取到，要么会重新敲门铃
+    q->doorbell = 0;
+    smp_mb();
+
+    while (ipi_dequeue(q, &msg)) {
+        msg.fn(msg.arg);
+        if (msg.sync != NULL) {
+            smp_mb();
+            atomic_fetch_add32(&msg.sync->pending, (uint32_t)-1);
+        }
+        batch++;
+    }
+
+    q->nr_irqs++;
+    q->nr_msgs += batch;
+    if (batch > q->max_batch) {
+        q->max_batch = batch;
+    }
+}
+
+// 投递一条消息，需要敲门铃时把目标记入ring；队列满时先处理自己的队列再重试
+static void ipi_post(int cpu, ipi_fn_t fn, void *arg, struct ipi_sync *sync, uint32_t *ring) {
+    struct ipi_queue *q = &ipi_queues[cpu];
+
+    while (!ipi_enqueue(q, fn, arg, sync)) {
+        ipi_handle();
+        cpu_relax();
+    }
+    // 消息发布与读门铃之间需要全屏障，与ipi_handle中清门铃后的屏障配对
+    smp_mb();
+    if (q->doorbell == 0 && atomic_swap32_acquire(&q->doorbell, 1) == 0) {
+        atomic_fetch_add64(&q->nr_rings, 1);
+        *ring |= 1U << cpu;
+    }
+}
+
+// 把需要敲门铃的hart按hart_mask_base分组，每组一次SBI调用
+static void ipi_ring(uint32_t ring) {
+    while (ring != 0) {
+        uint64_t base;
+        uint64_t mask = cpumask_next_harts(&ring, &base);
+        if (mask != 0) {
+            sbi_send_ipi(mask, base);
+        }
+    }
+}
+
+static void ipi_wait(struct ipi_sync *sync) {
+    while (load_acquire32(&sync->pending) != 0) {
+        uint64_t flags = local_irq_save();
+        ipi_handle();
+        local_irq_restore(flags);
+        cpu_relax();
+    }
+}
+
+void ipi_call(int cpu, ipi_fn_t fn, void *arg, int wait) {
+    struct ipi_sync sync = { .pending = 1 };
+    uint32_t ring = 0;
+
+    uint64_t flags = local_irq_save();
+    if (cpu == cpuid()) {
+        fn(arg);
+        local_irq_restore(flags);
+        return;
+    }
+    ipi_post(cpu, fn, arg, wait ? &sync : NULL, &ring);
+    ipi_ring(ring);
+    local_irq_restore(flags);
+
+    if (wait) {
+        ipi_wait(&sync);
+    }
+}
+
+void ipi_call_all(ipi_fn_t fn, void *arg, int wait) {
+    struct ipi_sync sync = { .pending = nr_cpus - 1 };
+    uint32_t ring = 0;
+
+    uint64_t flags = local_irq_save();
+    int self = cpuid();
+    for (int c = 0; c < nr_cpus; c++) {
+        if (c != self) {
+            ipi_post(c, fn, arg, wait ? &sync : NULL, &ring);
+        }
+    }
+    ipi_ring(ring);
+    fn(arg);
+    local_irq_restore(flags);
+
+    if (wait) {
+        ipi_wait(&sync);
+    }
+}
+
+void ipi_dump(void) {
+    pr_info("=== IPI统计 ===\n");
+    pr_info("cpu / 消息 / 门铃 / 中断 / 最大批量\n");
+    for (int i = 0; i < nr_cpus; i++) {
+        struct ipi_queue *q = &ipi_queues[i];
+        pr_info("cpu%d / %lu / %lu / %lu / %lu\n", i, q->nr_msgs, q->nr_rings,
+                q->nr_irqs, q->max_batch);
+    }
+}
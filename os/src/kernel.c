@@ -1,235 +1,37 @@
-#include <stdint.h>
-#include <stddef.h>
-
-// RISC-V CSR寄存器定义
-#define CSR_SSTATUS     0x100
-#define CSR_SIE         0x104
-#define CSR_STVEC       0x105
-#define CSR_SSCRATCH    0x140
-#define CSR_SEPC        0x141
-#define CSR_SCAUSE      0x142
-#define CSR_STVAL       0x143
-#define CSR_SIP         0x144
-#define CSR_SATP        0x180
-
-// SSTATUS寄存器位定义
-#define SSTATUS_SIE     (1UL << 1)
-#define SSTATUS_SPIE    (1UL << 5)
-#define SSTATUS_SPP     (1UL << 8)
-#define SSTATUS_SUM     (1UL << 18)
-
-// 中断相关定义
-#define IRQ_S_SOFT      1
-#define IRQ_S_TIMER     5
-#define IRQ_S_EXT       9
-
-// OpenSBI系统调用接口定义
-#define SBI_SET_TIMER 0
-#define SBI_CONSOLE_PUTCHAR 1
-#define SBI_CONSOLE_GETCHAR 2
-#define SBI_CLEAR_IPI 3
-#define SBI_SEND_IPI 4
-#define SBI_REMOTE_FENCE_I 5
-#define SBI_REMOTE_SFENCE_VMA 6
-#define SBI_REMOTE_SFENCE_VMA_ASID 7
-#define SBI_SHUTDOWN 8
-
-// SBI v0.2+ 扩展ID
-#define SBI_EXT_BASE            0x10
-#define SBI_EXT_TIME            0x54494D45
-#define SBI_EXT_IPI             0x735049
-#define SBI_EXT_RFENCE          0x52464E43
-#define SBI_EXT_HSM             0x48534D
-#define SBI_EXT_SRST            0x53525354
-
-// 设备树相关定义
-#define FDT_MAGIC       0xd00dfeed
-#define FDT_BEGIN_NODE  0x1
-#define FDT_END_NODE    0x2
-#define FDT_PROP        0x3
-#define FDT_NOP         0x4
-#define FDT_END         0x9
-
-// 页表相关定义（Sv39）
-#define SATP_MODE_SV39  (8UL << 60)
-#define PAGE_SHIFT      12
-#define PAGE_SIZE       (1UL << PAGE_SHIFT)
-#define PTE_V           (1UL << 0)   // 有效位
-#define PTE_R           (1UL << 1)   // 读权限
-#define PTE_W           (1UL << 2)   // 写权限
-#define PTE_X           (1UL << 3)   // 执行权限
-#define PTE_U           (1UL << 4)   // 用户模式访问
-#define PTE_G           (1UL << 5)   // 全局映射
-#define PTE_A           (1UL << 6)   // 访问位
-#define PTE_D           (1UL << 7)   // 脏位
-
-// 内存布局定义
-#define KERNEL_BASE     0x80200000UL
-#define KERNEL_VBASE    0xffffffffc0200000UL  // 虚拟地址基址
-#define UART_BASE       0x10000000UL
-#define UART_VBASE      0xffffffffc0000000UL  // UART虚拟地址
+#include "kernel.h"
+#include "riscv.h"
+#include "sbi.h"
+#include "fdt.h"
+#include "pmm.h"
+#include "cpu.h"
+#include "slab.h"
+#include "smp.h"
+#include "console.h"
+#include "printk.h"
+#include "plic.h"
+#include "uart.h"
+#include "trap.h"
+#include "timer.h"
+#include "sched.h"
+#include "lock.h"
+#include "ipi.h"
+#include "mm.h"
+#include "vmem.h"
+#include "reloc.h"
 
 // 全局变量
 static uint64_t boot_hartid;
 static uint64_t boot_fdt_addr;
 
-// SBI调用结构体
-struct sbiret {
-    long error;
-    long value;
-};
-
-// 设备树头部结构
-struct fdt_header {
-    uint32_t magic;
-    uint32_t totalsize;
-    uint32_t off_dt_struct;
-    uint32_t off_dt_strings;
-    uint32_t off_mem_rsvmap;
-    uint32_t version;
-    uint32_t last_comp_version;
-    uint32_t boot_cpuid_phys;
-    uint32_t size_dt_strings;
-    uint32_t size_dt_struct;
-};
-
-// CSR操作宏
-#define csr_read(csr) ({ \
-    unsigned long __v; \
-    asm volatile("csrr %0, " #csr : "=r"(__v) : : "memory"); \
-    __v; \
-})
-
-#define csr_write(csr, val) ({ \
-    asm volatile("csrw " #csr ", %0" : : "r"(val) : "memory"); \
-})
-
-#define csr_set(csr, val) ({ \
-    unsigned long __v; \
-    asm volatile("csrrs %0, " #csr ", %1" : "=r"(__v) : "r"(val) : "memory"); \
-    __v; \
-})
-
-#define csr_clear(csr, val) ({ \
-    unsigned long __v; \
-    asm volatile("csrrc %0, " #csr ", %1" : "=r"(__v) : "r"(val) : "memory"); \
-    __v; \
-})
-
-// 内联汇编实现SBI调用
-static inline struct sbiret sbi_ecall(int ext, int fid, unsigned long arg0,
-                                      unsigned long arg1, unsigned long arg2,
-                                      unsigned long arg3, unsigned long arg4,
-                                      unsigned long arg5) {
-    struct sbiret ret;
-    register unsigned long a0 asm("a0") = arg0;
-    register unsigned long a1 asm("a1") = arg1;
-    register unsigned long a2 asm("a2") = arg2;
-    register unsigned long a3 asm("a3") = arg3;
-    register unsigned long a4 asm("a4") = arg4;
-    register unsigned long a5 asm("a5") = arg5;
-    register unsigned long a6 asm("a6") = fid;
-    register unsigned long a7 asm("a7") = ext;
-    
-    asm volatile("ecall"
-                 : "+r"(a0), "+r"(a1)
-                 : "r"(a2), "r"(a3), "r"(a4), "r"(a5), "r"(a6), "r"(a7)
-                 : "memory");
-    
-    ret.error = a0;
-    ret.value = a1;
-    return ret;
-}
-
-// SBI服务接口
-void sbi_console_putchar(int ch) {
-    sbi_ecall(SBI_CONSOLE_PUTCHAR, 0, ch, 0, 0, 0, 0, 0);
-}
-
-struct sbiret sbi_get_spec_version(void) {
-    return sbi_ecall(SBI_EXT_BASE, 0, 0, 0, 0, 0, 0, 0);
-}
-
-struct sbiret sbi_get_impl_id(void) {
-    return sbi_ecall(SBI_EXT_BASE, 1, 0, 0, 0, 0, 0, 0);
-}
-
-struct sbiret sbi_probe_extension(long extension_id) {
-    return sbi_ecall(SBI_EXT_BASE, 3, extension_id, 0, 0, 0, 0, 0);
-}
-
-void sbi_set_timer(uint64_t stime_value) {
-    sbi_ecall(SBI_EXT_TIME, 0, stime_value, 0, 0, 0, 0, 0);
-}
-
-void sbi_shutdown(void) {
-    sbi_ecall(SBI_SHUTDOWN, 0, 0, 0, 0, 0, 0, 0);
-    while (1) {}
-}
-
-// 字符串和输出函数
-static inline int strlen(const char *s) {
-    int len = 0;
-    while (*s++) len++;
-    return len;
-}
-
-void puts(const char *s) {
-    while (*s) {
-        sbi_console_putchar(*s++);
-    }
-}
-
-void print_hex(uint64_t value) {
-    const char hex_chars[] = "0123456789abcdef";
-    char buffer[19] = "0x";
-    int i;
-    
-    for (i = 15; i >= 0; i--) {
-        buffer[2 + (15 - i)] = hex_chars[(value >> (i * 4)) & 0xf];
-    }
-    buffer[18] = '\0';
-    puts(buffer);
-}
-
-void print_dec(uint64_t value) {
-    char buffer[21];
-    int i = 0;
-    
-    if (value == 0) {
-        sbi_console_putchar('0');
-        return;
-    }
-    
-    while (value > 0) {
-        buffer[i++] = '0' + (value % 10);
-        value /= 10;
-    }
-    
-    while (--i >= 0) {
-        sbi_console_putchar(buffer[i]);
-    }
-}
-
-// 字节序转换
-static inline uint32_t be32_to_cpu(uint32_t val) {
-    return (val << 24) | ((val & 0xffffff00) << 16) | ((val & 0xffff0000) << 8) | (val & 0xff000000);
-}
-
 // 1. 验证传入参数
 int validate_boot_params(uint64_t hartid, uint64_t fdt_addr) {
     puts("=== 验证启动参数 ===\n");
     
-    // 验证HART ID（通常应该是0对于单核系统）
+    // HART ID不要求连续，smp_init时再映射为逻辑编号
     puts("HART ID: ");
     print_dec(hartid);
     puts("\n");
     
-    if (hartid >= 16) {  // 合理的HART数量限制
-        puts("错误: HART ID过大\n");
-        return -1;
-    }
-    
     // 验证FDT地址
     puts("FDT地址: ");
     print_hex(fdt_addr);
@@ -247,7 +49,7 @@ int validate_boot_params(uint64_t hartid, uint64_t fdt_addr) {
     }
     
     // 验证FDT魔数
-    struct fdt_header *fdt = (struct fdt_header *)fdt_addr;
+    struct fdt_header *fdt = __va(fdt_addr);
     uint32_t magic = be32_to_cpu(fdt->magic);
     
     puts("FDT魔数: ");
@@ -267,7 +69,7 @@ int validate_boot_params(uint64_t hartid, uint64_t fdt_addr) {
 int parse_device_tree(uint64_t fdt_addr) {
     puts("=== 解析设备树 ===\n");
     
-    struct fdt_header *fdt = (struct fdt_header *)fdt_addr;
+    struct fdt_header *fdt = __va(fdt_addr);
     uint32_t totalsize = be32_to_cpu(fdt->totalsize);
     uint32_t version = be32_to_cpu(fdt->version);
     
@@ -307,129 +109,356 @@ int parse_device_tree(uint64_t fdt_addr) {
         puts("错误: FDT偏移超出范围\n");
         return -1;
     }
+
+    // 一次遍历建立索引，之后的节点/属性查询都是常数时间
+    uint64_t t0 = csr_read(time);
+    if (fdt_index_build((uint64_t)__va(fdt_addr)) != 0) {
+        puts("错误: 设备树结构块格式错误\n");
+        return -1;
+    }
+    uint64_t t1 = csr_read(time);
+
+    puts("索引: 节点=");
+    print_dec(fdt_node_count());
+    puts(" 属性=");
+    print_dec(fdt_prop_count());
+    puts(" 耗时(ticks)=");
+    print_dec(t1 - t0);
+    puts("\n");
+
+    const char *model = fdt_path_getprop("/", "model", NULL);
+    if (model) {
+        puts("机器型号: ");
+        puts(model);
+        puts("\n");
+    }
     
     puts("✓ 设备树解析完成\n\n");
     return 0;
 }
 
-// Higer 4G in rv39
-static uint64_t page_table[512] __attribute__((aligned(4096)));
-static uint64_t page_table_h2[4][512] __attribute__((aligned(4096)));
-static uint64_t page_table_h3[4][512][512] __attribute__((aligned(4096)));
+// 根页表（Sv39 L2），即构建时生成的启动页表；
+// 此后建立的页表（用户地址空间、测试用页表）由页分配器按需提供
+static uint64_t *page_table;
+static int pt_pages;
+
+// 各级叶子PTE数量统计：[0]=4K, [1]=2M, [2]=1G
+static uint64_t pte_leaf_count[3];
+
+// 软件翻译缓存：每个hart一个直接映射表，以VPN和根页表为键，命中时省去三次相互依赖的访存。
+// 页表内容被删改时递增xlat_gen，所有hart上代数不符的表项都视为失效
+#define XLAT_CACHE_SIZE     64
+
+struct xlat_entry {
+    uint64_t vpn;
+    const uint64_t *root;
+    uint64_t pa_page;
+    uint64_t gen;
+};
+
+static struct xlat_entry xlat_cache[NCPU][XLAT_CACHE_SIZE];
+static volatile uint64_t xlat_gen = 1;
+static uint64_t xlat_hits[NCPU];
+static uint64_t xlat_misses[NCPU];
+
+static inline int va_is_canonical(uint64_t va) {
+    return ((int64_t)(va << 25) >> 25) == (int64_t)va;
+}
+
+int pt_translate(const uint64_t *root, uint64_t va, struct pt_walk_info *info) {
+    const uint64_t *table = root;
+
+    info->pa = 0;
+    info->pte = 0;
+    info->level = 2;
+    if (!va_is_canonical(va)) {
+        return -1;
+    }
 
-// Lower 4G in rv39
-static uint64_t page_table_l1[4][512] __attribute__((aligned(4096)));
-static uint64_t page_table_l0[4][512][512] __attribute__((aligned(4096)));
+    for (int level = 2; level >= 0; level--) {
+        uint64_t pte = table[VPN(va, level)];
+
+        info->pte = pte;
+        info->level = level;
+        // W=1且R=0是保留编码
+        if (!(pte & PTE_V) || ((pte & (PTE_R | PTE_W)) == PTE_W)) {
+            return -1;
+        }
+        if (pte & PTE_LEAF_MASK) {
+            // 大页的PPN低位必须为0，否则按规范是页错误
+            uint64_t pa = PTE_TO_PA(pte);
+            if (pa & (LEVEL_SIZE(level) - 1)) {
+                return -1;
+            }
+            info->pa = pa | (va & (LEVEL_SIZE(level) - 1));
+            return 0;
+        }
+        table = (const uint64_t *)__va(PTE_TO_PA(pte));
+    }
+    // 第0级仍不是叶子
+    return -1;
+}
 
+uint64_t va_to_pa(const uint64_t *root, uint64_t va) {
+    uint64_t vpn = va >> PAGE_SHIFT;
+    uint64_t pa = PT_BAD_PA;
+    uint64_t gen = xlat_gen;
+
+    uint64_t flags = local_irq_save();
+    int cpu = cpuid();
+    struct xlat_entry *e = &xlat_cache[cpu][vpn & (XLAT_CACHE_SIZE - 1)];
+
+    if (e->gen == gen && e->vpn == vpn && e->root == root) {
+        xlat_hits[cpu]++;
+        pa = e->pa_page | (va & (PAGE_SIZE - 1));
+    } else {
+        struct pt_walk_info info;
+        xlat_misses[cpu]++;
+        if (pt_translate(root, va, &info) == 0) {
+            // 大页也按4K粒度缓存
+            e->vpn = vpn;
+            e->root = root;
+            e->pa_page = info.pa & ~(PAGE_SIZE - 1);
+            e->gen = gen;
+            pa = info.pa;
+        }
+    }
+    local_irq_restore(flags);
+    return pa;
+}
+
+void xlat_cache_invalidate(void) {
+    __atomic_fetch_add(&xlat_gen, 1, __ATOMIC_RELEASE);
+}
+
+// 内核地址空间中va对应的物理地址，未映射返回PT_BAD_PA
 uint64_t va_2_pa_test(uint64_t va)
 {
+    return va_to_pa(page_table, va);
+}
 
+uint64_t *pt_alloc(void) {
+    uint64_t *pt = alloc_page();
+    if (pt == NULL) {
+        return NULL;
+    }
+    memset(pt, 0, PAGE_SIZE);
+    __atomic_fetch_add(&pt_pages, 1, __ATOMIC_RELAXED);
+    return pt;
 }
 
-// 3. 初始化MMU（简化的Sv39实现）
-// can refer to kvmmake in xv64
-void init_mmu(void) {
-    puts("=== 初始化MMU ===\n");
-    
-    // lower 4G directly mapping
-#if 0
-    uint64_t va = 0;
-    for (short i = 0; i < 4; ++i)
-    {
-        uint64_t l2_paddr = (uint64_t)page_table_l1[i];
-        page_table[i] = (l2_paddr >> 12) << 10 | PTE_V;
-        for (int j = 0; j < 512; ++j)
-        {
-            uint64_t l1_paddr = (uint64_t)&page_table_l0[i][j];
-            page_table_l1[i][j] = (l1_paddr >> 12) << 10 | PTE_V;
-            for (int k = 0; k < 512; ++k)
-            {
-                // uint64_t l0_paddr = (i << 30) | (j << 21) | (k << 12); wrong!!! integer overflow!
-                uint64_t l0_paddr = ((uint64_t)i << 30) | ((uint64_t)j << 21) | ((uint64_t)k << 12); // ✅
-                l0_paddr = ((l0_paddr >> 12) << 10) | PTE_V | PTE_R | PTE_W | PTE_X | PTE_A | PTE_D;
-                // uint64_t l0_paddr = (uint64_t)((va >> 12) << 10) | PTE_V | PTE_R | PTE_W | PTE_X | PTE_A | PTE_D;
-                page_table_l0[i][j][k] = l0_paddr;
-                va += 4096;
+// 释放level级页表及其下属的中间页表，叶子指向的物理页不归页表所有
+void pt_free(uint64_t *table, int level) {
+    for (int i = 0; i < 512 && level > 0; i++) {
+        if ((table[i] & PTE_V) && !(table[i] & PTE_LEAF_MASK)) {
+            pt_free(__va(PTE_TO_PA(table[i])), level - 1);
+        }
+    }
+    free_page(table);
+    __atomic_fetch_sub(&pt_pages, 1, __ATOMIC_RELAXED);
+    xlat_cache_invalidate();
+}
+
+// 从root开始逐级向下，返回level级页表中va对应的PTE，缺失的中间页表按需分配
+static uint64_t *pt_walk_create(uint64_t *root, uint64_t va, int level) {
+    uint64_t *table = root;
+
+    for (int l = 2; l > level; l--) {
+        uint64_t *pte = &table[VPN(va, l)];
+        if (*pte & PTE_V) {
+            if (*pte & PTE_LEAF_MASK) {
+                return NULL;    // 已被更大的页覆盖
             }
+            table = __va(PTE_TO_PA(*pte));
+        } else {
+            uint64_t *next = pt_alloc();
+            if (next == NULL) {
+                return NULL;
+            }
+            *pte = PA_TO_PTE(__pa(next)) | PTE_V;
+            table = next;
+        }
+    }
+    return &table[VPN(va, level)];
+}
+
+uint64_t *pt_walk(uint64_t *root, uint64_t va, int level) {
+    uint64_t *table = root;
+
+    for (int l = 2; l > level; l--) {
+        uint64_t pte = table[VPN(va, l)];
+        if (!(pte & PTE_V) || (pte & PTE_LEAF_MASK)) {
+            return NULL;
         }
+        table = __va(PTE_TO_PA(pte));
+    }
+    return &table[VPN(va, level)];
+}
+
+// 映射[va, va+size)到pa：对齐且剩余长度足够时优先用1G/2M叶子，只在边缘退化为4K
+int map_range(uint64_t *root, uint64_t va, uint64_t pa, uint64_t size, uint64_t perm) {
+    if ((va | pa | size) & (PAGE_SIZE - 1)) {
+        return -1;
     }
 
-#else
+    while (size > 0) {
+        int level = 2;
+        while (level > 0 &&
+               (((va | pa) & (LEVEL_SIZE(level) - 1)) || size < LEVEL_SIZE(level))) {
+            level--;
+        }
+
+        uint64_t *pte = pt_walk_create(root, va, level);
+        if (pte == NULL || (*pte & PTE_V)) {
+            return -1;
+        }
+        *pte = PA_TO_PTE(pa) | perm | PTE_V;
+        __atomic_fetch_add(&pte_leaf_count[level], 1, __ATOMIC_RELAXED);
 
-    for (uint64_t va = 0; va < ((uint64_t)4 << 30); va += 4096)
-    {
-        uint64_t *pte2 = &page_table[(va >> 30) & 0x1ff];
-        uint64_t l1_table = (uint64_t)page_table_l1[(va >> 30) & 0x1ff];
-        *pte2 = ((l1_table >> 12) << 10) | PTE_V;
-        uint64_t *pte1 = &((uint64_t*)l1_table)[(va >> 21) & 0x1ff];
-        uint64_t l0_table = (uint64_t)page_table_l0[(va >> 30) & 0x1ff][(va >> 21) & 0x1ff];
-        *pte1 = ((l0_table >> 12) << 10) | PTE_V;
-        uint64_t *pte0 = &((uint64_t*)l0_table)[(va >> 12) & 0x1ff];
-        *pte0 = (((va >> 12)) << 10) | PTE_V | PTE_R | PTE_W | PTE_X | PTE_A | PTE_D;
+        va += LEVEL_SIZE(level);
+        pa += LEVEL_SIZE(level);
+        size -= LEVEL_SIZE(level);
     }
-#endif
+    return 0;
+}
+
+// 3. 初始化MMU（简化的Sv39实现）
+// 启动页表在构建时生成（tools/gen_boot_pt.c），boot.S跳到高地址时已经写入satp
+void init_mmu(void) {
+    puts("=== 初始化MMU ===\n");
     
-    // 映射UART等设备（可选）
-    // page_table_l1[0] = (0x10000000UL >> 12) << 10 | PTE_V | PTE_R | PTE_W;
+    page_table = boot_page_table;
+
+    // 启动页表只线性映射低4G物理地址；物理内存更多时在根页表补1G叶子，不分配页表页
+    if (pmm_mem_end() > DIRECT_MAP_SIZE) {
+        uint64_t map_end = (pmm_mem_end() + LEVEL_SIZE(2) - 1) & ~(LEVEL_SIZE(2) - 1);
+        if (map_range(page_table, PAGE_OFFSET + DIRECT_MAP_SIZE, DIRECT_MAP_SIZE,
+                      map_end - DIRECT_MAP_SIZE,
+                      PTE_R | PTE_W | PTE_X | PTE_A | PTE_D | PTE_G) != 0) {
+            panic("线性映射建立失败");
+        }
+        asm volatile("sfence.vma zero, zero" ::: "memory");
+    }
     
-    // 设置SATP寄存器启用分页
-    uint64_t satp = SATP_MODE_SV39 | ((uint64_t)page_table >> 12);
+    uint64_t satp = csr_read(satp);
     
     puts("页表L2地址: ");
     print_hex((uint64_t)page_table);
     puts("\n");
+
+    puts("页表项统计: 1G=");
+    print_dec(boot_pt_stats[2] + pte_leaf_count[2]);
+    puts(" 2M=");
+    print_dec(boot_pt_stats[1] + pte_leaf_count[1]);
+    puts(" 4K=");
+    print_dec(boot_pt_stats[0] + pte_leaf_count[0]);
+    puts(" 页表页=");
+    print_dec(boot_pt_stats[3]);
+    puts("\n");
     
     puts("SATP值: ");
     print_hex(satp);
     puts("\n");
     
-    // 3. 原子地启用分页
-    asm volatile("sfence.vma zero, zero");
-    asm volatile("csrw satp, %0" : : "r" (satp));
-    asm volatile("sfence.vma zero, zero");
+    mm_init(page_table);
     
     puts("✅ MMU初始化完成\n\n");
     puts("hello, cyokeo has inited the mmu!!!\n");
 }
 
-// 异常处理函数
-void trap_handler(void) {
-    uint64_t scause = csr_read(scause);
-    uint64_t sepc = csr_read(sepc);
-    uint64_t stval = csr_read(stval);
-    
-    puts("!!! 异常发生 !!!\n");
-    puts("异常原因 (scause): ");
-    print_hex(scause);
-    puts("\n");
-    puts("异常PC (sepc): ");
-    print_hex(sepc);
-    puts("\n");
-    puts("异常值 (stval): ");
-    print_hex(stval);
-    puts("\n");
-    
-    // 简单处理：直接关机
-    puts("系统关机...\n");
-    sbi_shutdown();
+// 软件页表遍历：在临时页表里放4K、2M、1G三种叶子验证翻译结果，
+// 再对一组热点页比较每次完整遍历与翻译缓存命中的开销
+#define XLAT_BENCH_PAGES    16
+#define XLAT_BENCH_ROUNDS   4096
+
+static void test_va_translate(void) {
+    struct pt_walk_info info;
+    uint64_t *root = pt_alloc();
+    int errs = 0;
+
+    puts("=== 软件页表遍历 ===\n");
+    if (root == NULL ||
+        map_range(root, 4UL << 30, 0x80001000UL, XLAT_BENCH_PAGES * PAGE_SIZE, PTE_R | PTE_W) != 0 ||
+        map_range(root, 5UL << 30, 0x80200000UL, LEVEL_SIZE(1), PTE_R | PTE_W) != 0 ||
+        map_range(root, 8UL << 30, 0x80000000UL, LEVEL_SIZE(2), PTE_R | PTE_W | PTE_X) != 0) {
+        panic("临时页表建立失败");
+    }
+
+    static const struct {
+        uint64_t va;
+        uint64_t pa;        // PT_BAD_PA表示应当翻译失败
+        int level;
+    } cases[] = {
+        { (4UL << 30) + 0x3456,         0x80004456UL,   0 },
+        { (5UL << 30) + 0x12345,        0x80212345UL,   1 },
+        { (8UL << 30) + 0x1234567,      0x81234567UL,   2 },
+        { (4UL << 30) + XLAT_BENCH_PAGES * PAGE_SIZE, PT_BAD_PA, 0 },
+        { 6UL << 30,                    PT_BAD_PA,      2 },
+        { 0x0000008000000000UL,         PT_BAD_PA,      2 },    // 非规范地址
+    };
+    for (unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        int ret = pt_translate(root, cases[i].va, &info);
+        int ok = cases[i].pa == PT_BAD_PA ? ret != 0 :
+                 ret == 0 && info.pa == cases[i].pa && info.level == cases[i].level;
+        if (!ok || va_to_pa(root, cases[i].va) != cases[i].pa) {
+            printk(LOG_ERR, "翻译错误: va=0x%lx pa=0x%lx level=%d\n", cases[i].va, info.pa, info.level);
+            errs++;
+        }
+    }
+
+    volatile uint64_t sink = 0;
+    uint64_t t0 = rdtime();
+    for (int r = 0; r < XLAT_BENCH_ROUNDS; r++) {
+        for (int p = 0; p < XLAT_BENCH_PAGES; p++) {
+            pt_translate(root, (4UL << 30) + p * PAGE_SIZE + r, &info);
+            sink += info.pa;
+        }
+    }
+    uint64_t t1 = rdtime();
+    for (int r = 0; r < XLAT_BENCH_ROUNDS; r++) {
+        for (int p = 0; p < XLAT_BENCH_PAGES; p++) {
+            sink += va_to_pa(root, (4UL << 30) + p * PAGE_SIZE + r);
+        }
+    }
+    uint64_t t2 = rdtime();
+    (void)sink;
+
+    // 启动页表里的内核映射、线性映射和UART映射；低半部分不再有恒等映射
+    uint64_t kpa = __pa(test_va_translate);
+    if (va_2_pa_test((uint64_t)test_va_translate) != kpa ||
+        va_2_pa_test((uint64_t)__va(kpa)) != kpa ||
+        va_2_pa_test(UART_VBASE + 5) != UART_BASE + 5 ||
+        va_2_pa_test(kpa) != PT_BAD_PA) {
+        printk(LOG_ERR, "启动页表高地址映射错误\n");
+        errs++;
+    }
+
+    uint64_t n = (uint64_t)XLAT_BENCH_ROUNDS * XLAT_BENCH_PAGES;
+    printk(LOG_INFO, "翻译结果校验: 失败 %d, 内核va_2_pa(test_va_translate)=0x%lx\n", errs,
+           va_2_pa_test((uint64_t)test_va_translate));
+    printk(LOG_INFO, "完整遍历 %lu ns/次, 缓存命中 %lu ns/次 (命中 %lu, 未命中 %lu)\n",
+           (t1 - t0) * 1000000000 / timebase_freq / n, (t2 - t1) * 1000000000 / timebase_freq / n,
+           xlat_hits[cpuid()], xlat_misses[cpuid()]);
+
+    pt_free(root, 2);
+    puts("✓ 软件页表遍历测试完成\n\n");
 }
 
 // 4. 设置异常处理
 void setup_trap_handling(void) {
     puts("=== 设置异常处理 ===\n");
     
-    // 设置异常向量基址
+    // 设置异常向量基址（向量模式）
     extern void trap_vector(void);
-    csr_write(stvec, (uint64_t)trap_vector);
+    trap_init_hart();
     
     puts("异常向量地址: ");
     print_hex((uint64_t)trap_vector);
+    puts(" (向量模式)\n");
+    puts("陷入栈顶: ");
+    print_hex(mycpu()->trap_stack_top);
     puts("\n");
     
-    // 启用中断
-    csr_set(sstatus, SSTATUS_SIE);
-    csr_set(sie, (1UL << IRQ_S_TIMER) | (1UL << IRQ_S_EXT) | (1UL << IRQ_S_SOFT));
-    
     puts("SSTATUS: ");
     print_hex(csr_read(sstatus));
     puts("\n");
@@ -441,6 +470,291 @@ void setup_trap_handling(void) {
     puts("✓ 异常处理设置完成\n\n");
 }
 
+// 定时器测试：睡眠10ms并测量实际耗时
+static void test_timer(void) {
+    puts("=== 测试定时器 ===\n");
+
+    uint64_t start = rdtime();
+    msleep(10);
+    uint64_t elapsed = rdtime() - start;
+    printk(LOG_INFO, "msleep(10)实际耗时: %lu us\n", elapsed * 1000000 / timebase_freq);
+
+    puts("✓ 定时器测试完成\n\n");
+}
+
+// 并行任务演示：在所有hart上跑校验和与页表填充，由调度器的工作窃取分摊
+#define PAR_JOBS            16
+#define PAR_CSUM_ORDER      10                  // 4MB校验数据
+#define PAR_MAP_SIZE        (4UL << 20)         // 每个页表任务映射4MB，全部用4K页
+
+struct par_job {
+    int id;
+    int cpu;                // 完成时所在的cpu
+    const uint64_t *words;
+    uint64_t start;
+    uint64_t count;
+    uint64_t result;
+    uint64_t *root;
+    int err;
+};
+
+// 带位置权重的和，可以按任意切分并行计算后相加
+static uint64_t csum_words(const uint64_t *w, uint64_t start, uint64_t count) {
+    uint64_t sum = 0;
+    for (uint64_t i = start; i < start + count; i++) {
+        sum += w[i] * (2 * i + 1);
+    }
+    return sum;
+}
+
+static void csum_job(void *arg) {
+    struct par_job *job = arg;
+
+    job->result = csum_words(job->words, job->start, job->count);
+    job->cpu = cpuid();
+}
+
+// 每个任务占用根页表中不同的1G表项，互不共享中间页表
+static void ptfill_job(void *arg) {
+    struct par_job *job = arg;
+    uint64_t va = (uint64_t)(job->id + 1) << 30;
+    uint64_t pa = 0x80000000UL + PAGE_SIZE + (uint64_t)job->id * PAR_MAP_SIZE;
+
+    job->err = map_range(job->root, va, pa, PAR_MAP_SIZE, PTE_R | PTE_W);
+    for (uint64_t off = 0; off < PAR_MAP_SIZE && job->err == 0; off += PAGE_SIZE) {
+        uint64_t *pte = pt_walk(job->root, va + off, 0);
+        if (pte == NULL || !(*pte & PTE_V) || PTE_TO_PA(*pte) != pa + off) {
+            job->err = -1;
+        }
+    }
+    job->cpu = cpuid();
+}
+
+static void run_jobs(struct par_job *jobs, void (*fn)(void *arg), const char *name) {
+    struct thread *threads[PAR_JOBS];
+    int per_cpu[NCPU] = {0};
+
+    for (int i = 0; i < PAR_JOBS; i++) {
+        threads[i] = thread_create(name, fn, &jobs[i]);
+        if (threads[i] == NULL) {
+            panic("无法创建任务线程");
+        }
+    }
+    for (int i = 0; i < PAR_JOBS; i++) {
+        thread_join(threads[i]);
+        per_cpu[jobs[i].cpu]++;
+    }
+
+    pr_info("%s: 各cpu完成的任务数", name);
+    for (int i = 0; i < nr_cpus; i++) {
+        pr_info(" %d", per_cpu[i]);
+    }
+    pr_info("\n");
+}
+
+static void test_parallel_jobs(void) {
+    struct par_job jobs[PAR_JOBS];
+
+    pr_info("=== 并行任务 ===\n");
+
+    uint64_t *words = alloc_pages(PAR_CSUM_ORDER);
+    uint64_t nwords = (PAGE_SIZE << PAR_CSUM_ORDER) / sizeof(uint64_t);
+    if (words == NULL) {
+        panic("无法分配校验数据");
+    }
+    for (uint64_t i = 0; i < nwords; i++) {
+        words[i] = i * 0x9e3779b97f4a7c15UL;
+    }
+
+    uint64_t start = rdtime();
+    uint64_t expect = csum_words(words, 0, nwords);
+    uint64_t serial = rdtime() - start;
+
+    memset(jobs, 0, sizeof(jobs));
+    for (int i = 0; i < PAR_JOBS; i++) {
+        jobs[i].id = i;
+        jobs[i].words = words;
+        jobs[i].start = nwords / PAR_JOBS * i;
+        jobs[i].count = nwords / PAR_JOBS;
+    }
+    start = rdtime();
+    run_jobs(jobs, csum_job, "csum");
+    uint64_t parallel = rdtime() - start;
+
+    uint64_t sum = 0;
+    for (int i = 0; i < PAR_JOBS; i++) {
+        sum += jobs[i].result;
+    }
+    pr_info("校验和 0x%016lx %s, 串行 %lu us, 并行 %lu us\n", sum,
+            sum == expect ? "一致" : "不一致",
+            serial * 1000000 / timebase_freq, parallel * 1000000 / timebase_freq);
+    free_pages(words, PAR_CSUM_ORDER);
+
+    uint64_t *root = pt_alloc();
+    if (root == NULL) {
+        panic("无法分配页表");
+    }
+    memset(jobs, 0, sizeof(jobs));
+    for (int i = 0; i < PAR_JOBS; i++) {
+        jobs[i].id = i;
+        jobs[i].root = root;
+    }
+    start = rdtime();
+    run_jobs(jobs, ptfill_job, "ptfill");
+    uint64_t elapsed = rdtime() - start;
+
+    int errs = 0;
+    for (int i = 0; i < PAR_JOBS; i++) {
+        errs += jobs[i].err != 0;
+    }
+    pr_info("页表填充: %d个任务 × %lu个4K页, 失败 %d, 耗时 %lu us\n", PAR_JOBS,
+            PAR_MAP_SIZE / PAGE_SIZE, errs, elapsed * 1000000 / timebase_freq);
+    pt_free(root, 2);
+
+    pr_info("✓ 并行任务完成\n\n");
+}
+
+// 跨hart调用：同步广播测往返延迟，再向每个hart连续投递一批异步消息，看门铃合并的效果
+#define IPI_ROUNDS      100
+#define IPI_BURST       32
+
+static void ipi_count(void *arg) {
+    atomic_fetch_add32(arg, 1);
+}
+
+static void test_ipi(void) {
+    volatile uint32_t count = 0;
+
+    pr_info("=== 跨hart调用 ===\n");
+
+    uint64_t start = rdtime();
+    for (int i = 0; i < IPI_ROUNDS; i++) {
+        ipi_call_all(ipi_count, (void *)&count, 1);
+    }
+    uint64_t elapsed = rdtime() - start;
+    pr_info("ipi_call_all × %d: 计数 %u（应为 %d），平均 %lu us\n", IPI_ROUNDS, count,
+            IPI_ROUNDS * nr_cpus, elapsed * 1000000 / timebase_freq / IPI_ROUNDS);
+
+    count = 0;
+    for (int c = 0; c < nr_cpus; c++) {
+        for (int i = 0; i < IPI_BURST; i++) {
+            ipi_call(c, ipi_count, (void *)&count, 0);
+        }
+    }
+    // 同步调用排在各队列的最后，返回时前面的异步消息都已执行
+    for (int c = 0; c < nr_cpus; c++) {
+        ipi_call(c, ipi_count, (void *)&count, 1);
+    }
+    pr_info("异步投递: 计数 %u（应为 %d）\n", count, (IPI_BURST + 1) * nr_cpus);
+    ipi_dump();
+    pr_info("✓ 跨hart调用测试完成\n\n");
+}
+
+// 地址空间与TLB批量刷新：多个线程在同一地址空间中各自映射几页并在不同hart上访问，
+// 然后分一小批和一大批取消映射，前者按范围刷新，后者整体刷新ASID
+#define TLB_TEST_VA         (8UL << 30)     // 低半部分，内核页表中没有映射
+#define TLB_TEST_THREADS    8
+#define TLB_TEST_ORDER      3               // 每个线程8页
+
+struct tlb_job {
+    struct mm *mm;
+    int id;
+    int err;
+    void *pages;
+};
+
+static inline uint64_t tlb_job_va(int id) {
+    return TLB_TEST_VA + ((uint64_t)id << (PAGE_SHIFT + TLB_TEST_ORDER));
+}
+
+static void tlb_job(void *arg) {
+    struct tlb_job *job = arg;
+    uint64_t va = tlb_job_va(job->id);
+    uint64_t size = PAGE_SIZE << TLB_TEST_ORDER;
+
+    job->pages = alloc_pages(TLB_TEST_ORDER);
+    if (job->pages == NULL ||
+        mm_map(job->mm, va, __pa(job->pages), size, PTE_R | PTE_W | PTE_A | PTE_D) != 0) {
+        job->err = 1;
+        return;
+    }
+
+    thread_set_mm(job->mm);
+    for (uint64_t off = 0; off < size; off += PAGE_SIZE) {
+        *(volatile uint64_t *)(va + off) = va + off;
+    }
+    // 睡眠后多半换了hart，经新hart的TLB再读一遍
+    msleep(1);
+    for (uint64_t off = 0; off < size; off += PAGE_SIZE) {
+        if (*(volatile uint64_t *)(va + off) != va + off ||
+            *(uint64_t *)((uint64_t)job->pages + off) != va + off) {
+            job->err = 1;
+        }
+    }
+    thread_set_mm(NULL);
+}
+
+static void test_tlb(void) {
+    struct tlb_job jobs[TLB_TEST_THREADS];
+    struct thread *threads[TLB_TEST_THREADS];
+    struct tlb_batch batch;
+
+    pr_info("=== 地址空间与TLB刷新 ===\n");
+
+    struct mm *mm = mm_create();
+    if (mm == NULL) {
+        panic("无法创建地址空间");
+    }
+    memset(jobs, 0, sizeof(jobs));
+    for (int i = 0; i < TLB_TEST_THREADS; i++) {
+        jobs[i].mm = mm;
+        jobs[i].id = i;
+        threads[i] = thread_create("tlb", tlb_job, &jobs[i]);
+        if (threads[i] == NULL) {
+            panic("无法创建任务线程");
+        }
+    }
+    int errs = 0;
+    for (int i = 0; i < TLB_TEST_THREADS; i++) {
+        thread_join(threads[i]);
+        errs += jobs[i].err;
+    }
+    pr_info("映射访问: 失败 %d, 用过该ASID的cpu位图 0x%x\n", errs, mm->cpumask);
+
+    // 第一批只有一个线程的8页：按范围刷新；第二批其余56页：整体刷新
+    tlb_batch_init(&batch, mm);
+    mm_unmap(mm, tlb_job_va(0), PAGE_SIZE << TLB_TEST_ORDER, &batch);
+    tlb_batch_flush(&batch);
+    for (int i = 1; i < TLB_TEST_THREADS; i++) {
+        mm_unmap(mm, tlb_job_va(i), PAGE_SIZE << TLB_TEST_ORDER, &batch);
+    }
+    tlb_batch_flush(&batch);
+
+    for (int i = 0; i < TLB_TEST_THREADS; i++) {
+        free_pages(jobs[i].pages, TLB_TEST_ORDER);
+    }
+    mm_destroy(mm);
+
+    // 反复给同一个地址空间分配新ASID，直到发生一次翻转
+    if (mm_asid_bits() > 0) {
+        struct mm *scratch = mm_create();
+        if (scratch == NULL) {
+            panic("无法创建地址空间");
+        }
+        uint64_t flags = local_irq_save();
+        for (uint64_t i = 0; i < (1UL << mm_asid_bits()); i++) {
+            scratch->context = 0;
+            switch_mm(scratch);
+            switch_mm(&init_mm);
+        }
+        local_irq_restore(flags);
+        mm_destroy(scratch);
+    }
+
+    mm_dump();
+    pr_info("✓ TLB刷新测试完成\n\n");
+}
+
 // 5. 测试SBI服务
 void test_sbi_services(void) {
     puts("=== 测试SBI服务 ===\n");
@@ -474,14 +788,19 @@ void test_sbi_services(void) {
     puts("\n");
     
     // 测试扩展探测
-    const char *extensions[] = {"BASE", "TIME", "IPI", "RFENCE", "HSM", "SRST"};
-    long ext_ids[] = {SBI_EXT_BASE, SBI_EXT_TIME, SBI_EXT_IPI, 
-                      SBI_EXT_RFENCE, SBI_EXT_HSM, SBI_EXT_SRST};
-    
-    for (int i = 0; i < 6; i++) {
-        ret = sbi_probe_extension(ext_ids[i]);
+    static const struct {
+        const char *name;
+        long id;
+    } extensions[] = {
+        {"BASE", SBI_EXT_BASE}, {"TIME", SBI_EXT_TIME}, {"IPI", SBI_EXT_IPI},
+        {"RFENCE", SBI_EXT_RFENCE}, {"HSM", SBI_EXT_HSM}, {"SRST", SBI_EXT_SRST},
+        {"DBCN", SBI_EXT_DBCN},
+    };
+    
+    for (unsigned int i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++) {
+        ret = sbi_probe_extension(extensions[i].id);
         puts("扩展 ");
-        puts(extensions[i]);
+        puts(extensions[i].name);
         puts(": ");
         if (ret.error == 0 && ret.value == 1) {
             puts("支持");
@@ -491,14 +810,91 @@ void test_sbi_services(void) {
         puts("\n");
     }
     
+    puts("控制台后端: ");
+    puts(console_get_backend() == CONSOLE_SBI_DBCN ? "DBCN\n" : "legacy putchar\n");
+
     puts("✓ SBI服务测试完成\n\n");
 }
 
+// init线程：初始化完成后的演示任务与关机
+// 按需分配：预留一大块缓冲区只登记不映射，稀疏地访问其中一部分，
+// 第一次访问的页读到的必须是0，驻留的页数等于访问过的页数
+#define LAZY_TEST_SIZE      (64UL << 20)
+#define LAZY_TEST_STRIDE    (1UL << 20)
+
+static void test_lazy(void) {
+    puts("=== 按需分配测试 ===\n");
+
+    uint64_t t0 = rdtime();
+    uint8_t *buf = vmem_alloc(LAZY_TEST_SIZE, "lazy-test");
+    uint64_t t1 = rdtime();
+    if (buf == NULL) {
+        panic("懒分配区预留失败");
+    }
+    uint64_t free_before = pmm_free_pages();
+
+    int errs = 0;
+    for (uint64_t off = 0; off < LAZY_TEST_SIZE; off += LAZY_TEST_STRIDE) {
+        if (buf[off + 123] != 0) {
+            errs++;
+        }
+        buf[off + 123] = (uint8_t)(off >> 20);
+    }
+    uint64_t t2 = rdtime();
+    for (uint64_t off = 0; off < LAZY_TEST_SIZE; off += LAZY_TEST_STRIDE) {
+        if (buf[off + 123] != (uint8_t)(off >> 20)) {
+            errs++;
+        }
+    }
+    uint64_t used = free_before - pmm_free_pages();
+    uint64_t touched = LAZY_TEST_SIZE / LAZY_TEST_STRIDE;
+
+    printk(LOG_INFO, "预留 %lu MB 耗时 %lu ticks; 访问 %lu 页耗时 %lu ticks, 占用物理页 %lu（含L0页表）, 错误 %d\n",
+           LAZY_TEST_SIZE >> 20, t1 - t0, touched, t2 - t1, used, errs);
+    vmem_free(buf);
+    puts("✓ 按需分配测试完成\n\n");
+}
+
+static void init_thread(void *arg) {
+    (void)arg;
+
+    test_parallel_jobs();
+    test_ipi();
+    test_tlb();
+    test_lazy();
+
+    puts("========================================\n");
+    puts("       内核初始化完成！\n");
+    puts("========================================\n");
+    puts("\n");
+    puts("Hello World from Enhanced RISC-V Kernel!\n");
+    puts("所有子系统已初始化完成\n");
+    puts("内核运行正常，准备关机...\n\n");
+
+    kmem_dump();
+    sched_dump();
+    vmem_dump();
+    plic_dump();
+    puts("=== 锁统计（time计数） ===\n");
+    lock_stat_dump(puts);
+    printk_drain();
+    
+    // 等待一下，期间hart处于wfi
+    msleep(100);
+    
+    puts("系统正常关机\n");
+    console_sync();
+    sbi_shutdown();
+}
+
 // 内核主函数
 void kernel_main(uint64_t hartid, uint64_t fdt_addr) {
     // 保存启动参数
     boot_hartid = hartid;
     boot_fdt_addr = fdt_addr;
+
+    // 控制台后端：支持DBCN时整行一次ecall输出
+    console_init();
     
     puts("\n");
     puts("========================================\n");
@@ -508,39 +904,59 @@ void kernel_main(uint64_t hartid, uint64_t fdt_addr) {
     puts("架构: RISC-V 64位 (Supervisor Mode)\n");
     puts("构建: " __DATE__ " " __TIME__ "\n\n");
     
+    // boot.S在跳到高地址后已经处理完重定位，这里只报告结果
+    reloc_dump();
 
     // 1. 验证传入参数
     if (validate_boot_params(hartid, fdt_addr) != 0) {
         puts("❌ 启动参数验证失败，系统关机\n");
         // sbi_shutdown();
     }
-#if 0
+
+    // 早期线性分配从内核镜像之后开始，设备树索引的arena也来自这里
+    pmm_early_init(fdt_addr);
+
     // 2. 解析设备树
     if (parse_device_tree(fdt_addr) != 0) {
-        puts("设备树解析失败，系统关机\n");
-        sbi_shutdown();
+        panic("设备树解析失败，系统关机");
+    }
+    timer_init();
+
+    // 物理页分配器：页表等后续结构都从这里按需分配
+    if (pmm_init() != 0) {
+        panic("物理内存初始化失败，系统关机");
     }
-#endif
+
     // 3. 初始化MMU
     init_mmu();
+    vmem_init();
+    
+    test_va_translate();
+
+    // 小对象分配器
+    kmalloc_init();
     
     // 4. 设置异常处理
     setup_trap_handling();
     
     // 5. 测试SBI服务
     test_sbi_services();
+    test_timer();
     
-    puts("========================================\n");
-    puts("       内核初始化完成！\n");
-    puts("========================================\n");
-    puts("\n");
-    puts("Hello World from Enhanced RISC-V Kernel!\n");
-    puts("所有子系统已初始化完成\n");
-    puts("内核运行正常，准备关机...\n\n");
+    // 6. 启动其余hart，从核上线后直接进入各自的调度循环
+    sched_init();
+    ipi_init();
+    smp_init(hartid);
     
-    // 等待一下（通过简单循环）
-    for (volatile int i = 0; i < 1000000; i++);
+    // 7. 外设中断：PLIC + UART，成功后控制台改走UART
+    if (plic_init() == 0 && uart_init() == 0) {
+        console_set_backend(CONSOLE_UART);
+        puts("控制台已切换到中断驱动的UART\n\n");
+    }
     
-    puts("系统正常关机\n");
-    sbi_shutdown();
-}
\ No newline at end of file
+    // 8. 其余工作交给init线程，启动hart也进入调度循环
+    if (thread_create("init", init_thread, NULL) == NULL) {
+        panic("无法创建init线程");
+    }
+    sched_run();
+}
@@ -0,0 +1,346 @@
+#include "kernel.h"
+#include "riscv.h"
+#include "sbi.h"
+#include "cpu.h"
+#include "smp.h"
+#include "pmm.h"
+#include "slab.h"
+#include "atomic.h"
+#include "printk.h"
+#include "mm.h"
+
+#define ASID_MAX_BITS   16
+
+struct mm init_mm;
+
+static int asid_bits;
+static uint64_t asid_mask;
+static uint64_t asid_generation;            // 当前代，以1 << asid_bits为单位递增
+static uint64_t asid_map[(1 << ASID_MAX_BITS) / 64];
+static uint64_t asid_hint = 1;
+static uint64_t reserved_asid[NCPU];        // 翻转时各hart正在使用的context
+static uint32_t flush_pending;              // 翻转后还没整体刷新过本地TLB的cpu
+static struct spinlock asid_lock = SPINLOCK_INIT("asid");
+
+// 每个hart当前使用的context与地址空间，只由本hart写（翻转时由持锁者读）
+static volatile uint64_t active_asid[NCPU];
+static struct mm *active_mm[NCPU];
+
+static volatile uint64_t nr_asid_alloc;
+static volatile uint64_t nr_rollover;
+static volatile uint64_t nr_local_full;
+static volatile uint64_t nr_batches;
+static volatile uint64_t nr_ranged;
+static volatile uint64_t nr_full;
+static volatile uint64_t nr_remote_calls;
+static volatile uint64_t nr_remote_harts;
+
+static inline void sfence_vma_asid(uint64_t va, uint64_t asid) {
+    asm volatile("sfence.vma %0, %1" : : "r"(va), "r"(asid) : "memory");
+}
+
+static inline void sfence_vma_all_asid(uint64_t asid) {
+    asm volatile("sfence.vma zero, %0" : : "r"(asid) : "memory");
+}
+
+void mm_init(uint64_t *root) {
+    init_mm.root = root;
+    init_mm.context = 0;
+    spin_lock_init(&init_mm.lock, "init_mm");
+
+    // ASID字段中实现了的位可写，其余恒为0
+    uint64_t satp = csr_read(satp);
+    csr_write(satp, satp | SATP_ASID_MASK);
+    uint64_t probed = (csr_read(satp) & SATP_ASID_MASK) >> SATP_ASID_SHIFT;
+    csr_write(satp, satp);
+    asm volatile("sfence.vma zero, zero");
+
+    while (asid_bits < ASID_MAX_BITS && (probed & (1UL << asid_bits))) {
+        asid_bits++;
+    }
+    asid_mask = (1UL << asid_bits) - 1;
+    asid_generation = 1UL << asid_bits;
+    asid_map[0] = 1;
+
+    puts("ASID位数: ");
+    print_dec(asid_bits);
+    puts("\n");
+}
+
+int mm_asid_bits(void) {
+    return asid_bits;
+}
+
+static inline int asid_test(uint64_t asid) {
+    return (asid_map[asid / 64] >> (asid % 64)) & 1;
+}
+
+static inline void asid_set(uint64_t asid) {
+    asid_map[asid / 64] |= 1UL << (asid % 64);
+}
+
+// 从hint开始找空闲ASID，没有返回0
+static uint64_t asid_find_free(uint64_t hint) {
+    uint64_t nwords = (asid_mask + 64) / 64;
+
+    for (uint64_t i = 0; i < nwords; i++) {
+        uint64_t w = (hint / 64 + i) % nwords;
+        uint64_t free = ~asid_map[w];
+        if (w == nwords - 1 && ((asid_mask + 1) % 64) != 0) {
+            free &= (1UL << ((asid_mask + 1) % 64)) - 1;
+        }
+        for (int b = 0; free != 0 && b < 64; b++) {
+            if (free & (1UL << b)) {
+                return w * 64 + b;
+            }
+        }
+    }
+    return 0;
+}
+
+// 持asid_lock：进入新一代，正在各hart上运行的ASID保留原号
+static void asid_rollover(void) {
+    asid_generation += 1UL << asid_bits;
+    // 与switch_mm快路径中先写active_asid再读代数配对
+    smp_mb();
+
+    memset(asid_map, 0, sizeof(asid_map));
+    asid_map[0] = 1;
+    for (int c = 0; c < nr_cpus; c++) {
+        reserved_asid[c] = active_asid[c];
+        if (reserved_asid[c] != 0) {
+            asid_set(reserved_asid[c] & asid_mask);
+        }
+    }
+    flush_pending = (1U << nr_cpus) - 1;
+    asid_hint = 1;
+    nr_rollover++;
+}
+
+// 持asid_lock：为上一代（或从未分配）的地址空间分配当前代的context
+static uint64_t asid_new_context(struct mm *mm) {
+    uint64_t old = mm->context;
+    uint64_t asid;
+
+    if (old != 0) {
+        int kept = 0;
+        for (int c = 0; c < nr_cpus; c++) {
+            if (reserved_asid[c] == old) {
+                reserved_asid[c] = asid_generation | (old & asid_mask);
+                kept = 1;
+            }
+        }
+        if (kept) {
+            return asid_generation | (old & asid_mask);
+        }
+        // 原来的号在新一代中仍空闲就继续用，cpumask随之保留
+        asid = old & asid_mask;
+        if (!asid_test(asid)) {
+            asid_set(asid);
+            return asid_generation | asid;
+        }
+    }
+
+    asid = asid_find_free(asid_hint);
+    if (asid == 0) {
+        asid_rollover();
+        asid = asid_find_free(asid_hint);
+    }
+    asid_set(asid);
+    asid_hint = asid + 1;
+    nr_asid_alloc++;
+    // 换了号，旧号在其他hart上留下的TLB项与新号无关
+    mm->cpumask = 0;
+    return asid_generation | asid;
+}
+
+void switch_mm(struct mm *mm) {
+    int cpu = cpuid();
+    uint64_t ctx = mm->context;
+    int flush = 0;
+
+    if (mm == &init_mm) {
+        active_asid[cpu] = 0;
+    } else if (asid_bits == 0) {
+        // 不支持ASID：所有地址空间共用0号，每次切换都要整体刷新
+        flush = active_mm[cpu] != mm;
+    } else {
+        int fast = 0;
+        if (ctx != 0 && (ctx & ~asid_mask) == __atomic_load_n(&asid_generation, __ATOMIC_RELAXED) &&
+            !(flush_pending & (1U << cpu))) {
+            active_asid[cpu] = ctx;
+            smp_mb();
+            fast = (ctx & ~asid_mask) == __atomic_load_n(&asid_generation, __ATOMIC_RELAXED);
+        }
+        if (!fast) {
+            spin_lock(&asid_lock);
+            ctx = mm->context;
+            if ((ctx & ~asid_mask) != asid_generation || ctx == 0) {
+                ctx = asid_new_context(mm);
+                mm->context = ctx;
+            }
+            active_asid[cpu] = ctx;
+            if (flush_pending & (1U << cpu)) {
+                flush_pending &= ~(1U << cpu);
+                flush = 1;
+            }
+            spin_unlock(&asid_lock);
+        }
+    }
+
+    if (active_mm[cpu] == mm && !flush) {
+        return;
+    }
+    active_mm[cpu] = mm;
+    atomic_fetch_or32(&mm->cpumask, 1U << cpu);
+
+    uint64_t asid = ctx & asid_mask;
+    csr_write(satp, SATP_MODE_SV39 | (asid << SATP_ASID_SHIFT) | (__pa(mm->root) >> 12));
+    if (flush) {
+        asm volatile("sfence.vma zero, zero");
+        atomic_fetch_add64(&nr_local_full, 1);
+    }
+}
+
+struct mm *mm_create(void) {
+    struct mm *mm = kzalloc(sizeof(*mm));
+    if (mm == NULL) {
+        return NULL;
+    }
+    mm->root = pt_alloc();
+    if (mm->root == NULL) {
+        kfree(mm);
+        return NULL;
+    }
+    memcpy(mm->root, init_mm.root, PAGE_SIZE);
+    spin_lock_init(&mm->lock, "mm");
+    return mm;
+}
+
+// 调用者保证已经没有hart在使用这个地址空间；ASID留到下一次翻转才回收
+void mm_destroy(struct mm *mm) {
+    for (int i = 0; i < 512; i++) {
+        if (mm->root[i] == init_mm.root[i]) {
+            mm->root[i] = 0;
+        }
+    }
+    pt_free(mm->root, 2);
+    kfree(mm);
+}
+
+int mm_map(struct mm *mm, uint64_t va, uint64_t pa, uint64_t size, uint64_t perm) {
+    spin_lock(&mm->lock);
+    int ret = map_range(mm->root, va, pa, size, perm);
+    spin_unlock(&mm->lock);
+
+    // 规范允许缓存无效的PTE：cpumask里的每个hart都可能留着旧的无效翻译，
+    // 与取消映射一样经tlb_batch刷新，否则它们访问新映射会缺页
+    struct tlb_batch batch;
+    tlb_batch_init(&batch, mm);
+    tlb_batch_add(&batch, va, size);
+    tlb_batch_flush(&batch);
+    return ret;
+}
+
+int mm_unmap(struct mm *mm, uint64_t va, uint64_t size, struct tlb_batch *batch) {
+    int n = 0;
+
+    spin_lock(&mm->lock);
+    for (uint64_t off = 0; off < size; off += PAGE_SIZE) {
+        uint64_t *pte = pt_walk(mm->root, va + off, 0);
+        if (pte != NULL && (*pte & PTE_V)) {
+            *pte = 0;
+            n++;
+        }
+    }
+    spin_unlock(&mm->lock);
+
+    if (n > 0) {
+        xlat_cache_invalidate();
+    }
+    tlb_batch_add(batch, va, size);
+    return n;
+}
+
+void tlb_batch_init(struct tlb_batch *b, struct mm *mm) {
+    b->mm = mm;
+    b->nr = 0;
+    b->pages = 0;
+}
+
+void tlb_batch_add(struct tlb_batch *b, uint64_t va, uint64_t size) {
+    if (b->nr > 0 && b->end[b->nr - 1] == va) {
+        b->end[b->nr - 1] += size;
+    } else {
+        if (b->nr == TLB_BATCH_RANGES) {
+            tlb_batch_flush(b);
+        }
+        b->start[b->nr] = va;
+        b->end[b->nr] = va + size;
+        b->nr++;
+    }
+    b->pages += size / PAGE_SIZE;
+}
+
+void tlb_batch_flush(struct tlb_batch *b) {
+    struct mm *mm = b->mm;
+    uint64_t lo = UINT64_MAX, hi = 0;
+
+    if (b->nr == 0) {
+        return;
+    }
+    for (int i = 0; i < b->nr; i++) {
+        if (b->start[i] < lo) lo = b->start[i];
+        if (b->end[i] > hi) hi = b->end[i];
+    }
+    // 本地按段逐页刷新；远端一次调用只能带一个范围，覆盖范围超过阈值时同样整体刷新
+    int full = b->pages > TLB_FLUSH_THRESHOLD;
+    int remote_full = full || (hi - lo) / PAGE_SIZE > TLB_FLUSH_THRESHOLD;
+
+    // PTE的清除先于任何hart的刷新可见
+    smp_mb();
+
+    uint64_t flags = local_irq_save();
+    uint64_t asid = mm->context & asid_mask;
+    int self = cpuid();
+    uint32_t remote = mm->cpumask & ~(1U << self);
+
+    if (mm->cpumask & (1U << self)) {
+        if (full) {
+            sfence_vma_all_asid(asid);
+        } else {
+            for (int i = 0; i < b->nr; i++) {
+                for (uint64_t va = b->start[i]; va < b->end[i]; va += PAGE_SIZE) {
+                    sfence_vma_asid(va, asid);
+                }
+            }
+        }
+    }
+    while (remote != 0) {
+        uint64_t base;
+        uint64_t harts = cpumask_next_harts(&remote, &base);
+        if (harts == 0) {
+            break;
+        }
+        sbi_remote_sfence_vma_asid(harts, base, remote_full ? 0 : lo,
+                                   remote_full ? (uint64_t)-1 : hi - lo, asid);
+        atomic_fetch_add64(&nr_remote_calls, 1);
+        for (uint64_t h = harts; h != 0; h &= h - 1) {
+            atomic_fetch_add64(&nr_remote_harts, 1);
+        }
+    }
+    local_irq_restore(flags);
+
+    atomic_fetch_add64(&nr_batches, 1);
+    atomic_fetch_add64(full || remote_full ? &nr_full : &nr_ranged, 1);
+    b->nr = 0;
+    b->pages = 0;
+}
+
+void mm_dump(void) {
+    pr_info("=== ASID与TLB刷新统计 ===\n");
+    pr_info("ASID位数 %d, 当前代 %lu, 分配 %lu, 翻转 %lu, 翻转后本地整体刷新 %lu\n",
+            asid_bits, asid_generation >> asid_bits, nr_asid_alloc, nr_rollover, nr_local_full);
+    pr_info("批次 %lu: 按范围 %lu, 整体 %lu; 远端调用 %lu, 目标hart %lu\n",
+            nr_batches, nr_ranged, nr_full, nr_remote_calls, nr_remote_harts);
+}
@@ -0,0 +1,219 @@
+#include "kernel.h"
+#include "riscv.h"
+#include "fdt.h"
+#include "cpu.h"
+#include "spinlock.h"
+#include "printk.h"
+#include "plic.h"
+
+// PLIC驱动
+// 每个中断源有一个亲和性掩码（逻辑cpu位图），掩码内每个hart的S模式上下文都使能该源。
+// 多个上下文同时使能时PLIC会通知所有hart，但同一个源在完成之前只能被认领一次，
+// 因此处理函数不会在两个hart上并发执行；没抢到的hart认领到0，记为空认领。
+// 一次外部中断里反复认领直到没有待处理的源，多个设备同时触发时只陷入一次。
+
+// PLIC寄存器布局
+#define PLIC_PRIORITY(irq)      (plic_base + 4 * (irq))
+#define PLIC_ENABLE(ctx)        (plic_base + 0x2000 + 0x80 * (ctx))
+#define PLIC_THRESHOLD(ctx)     (plic_base + 0x200000 + 0x1000 * (ctx))
+#define PLIC_CLAIM(ctx)         (plic_base + 0x200004 + 0x1000 * (ctx))
+
+#define PLIC_REG(addr)          (*(volatile uint32_t *)(addr))
+
+struct irq_action {
+    irq_handler_t handler;
+    void *arg;
+    uint32_t affinity;
+    uint64_t count;             // 认领是互斥的，不需要原子操作
+};
+
+struct plic_stat {
+    uint64_t traps;             // 外部中断陷入次数
+    uint64_t claims;            // 认领到的中断数
+    uint64_t spurious;          // 陷入后一个也没认领到
+    uint64_t max_batch;         // 一次陷入认领到的最多中断数
+} __attribute__((aligned(64)));
+
+static uint64_t plic_base;
+static uint32_t plic_ndev;
+static int plic_ctx[NCPU];      // 逻辑cpu -> S模式上下文，-1表示没有
+static struct irq_action irq_table[PLIC_MAX_IRQ];
+static struct plic_stat plic_stats[NCPU];
+// 使能寄存器按上下文分组，每个字包含32个源，读-改-写要互斥
+static struct spinlock plic_lock = SPINLOCK_INIT("plic");
+
+static int plic_find_node(void) {
+    int n = fdt_find_compatible(-1, "riscv,plic0");
+    if (n < 0) {
+        n = fdt_find_compatible(-1, "sifive,plic-1.0.0");
+    }
+    return n;
+}
+
+// 解析interrupts-extended：第i项指向某个hart的本地中断控制器，
+// 中断号为IRQ_S_EXT的项就是该hart的S模式上下文
+static void plic_parse_contexts(int node) {
+    uint32_t len;
+    const uint32_t *cells = fdt_getprop(node, "interrupts-extended", &len);
+
+    for (int i = 0; i < NCPU; i++) {
+        plic_ctx[i] = -1;
+    }
+    if (cells == NULL) {
+        return;
+    }
+
+    uint32_t ncells = len / 4;
+    int ctx = 0;
+    for (uint32_t i = 0; i < ncells; ctx++) {
+        int intc = fdt_find_phandle(be32_to_cpu(cells[i]));
+        uint32_t icells = 1;
+        if (intc < 0) {
+            return;
+        }
+        fdt_getprop_u32(intc, "#interrupt-cells", &icells);
+        uint32_t irq = be32_to_cpu(cells[i + 1]);
+        i += 1 + icells;
+
+        uint64_t hartid;
+        if (irq != IRQ_S_EXT || fdt_get_reg(fdt_node(intc)->parent, 0, &hartid, NULL) != 0) {
+            continue;
+        }
+        for (int c = 0; c < nr_cpus; c++) {
+            if (cpus[c].hartid == hartid) {
+                plic_ctx[c] = ctx;
+            }
+        }
+    }
+}
+
+int plic_init(void) {
+    int node = plic_find_node();
+    if (node < 0 || fdt_get_reg(node, 0, &plic_base, NULL) != 0) {
+        return -1;
+    }
+    // 寄存器经线性映射访问
+    plic_base = (uint64_t)__va(plic_base);
+    if (fdt_getprop_u32(node, "riscv,ndev", &plic_ndev) != 0 || plic_ndev >= PLIC_MAX_IRQ) {
+        plic_ndev = PLIC_MAX_IRQ - 1;
+    }
+    plic_parse_contexts(node);
+
+    // 各hart的S模式上下文接受所有优先级大于0的中断
+    for (int c = 0; c < nr_cpus; c++) {
+        if (plic_ctx[c] >= 0) {
+            PLIC_REG(PLIC_THRESHOLD(plic_ctx[c])) = 0;
+        }
+    }
+
+    puts("PLIC基址: ");
+    print_hex(plic_base);
+    puts(" 中断源数: ");
+    print_dec(plic_ndev);
+    puts(" cpu0上下文: ");
+    print_dec(plic_ctx[0]);
+    puts("\n");
+    return 0;
+}
+
+static void plic_enable(int ctx, int irq, int on) {
+    volatile uint32_t *en = (volatile uint32_t *)PLIC_ENABLE(ctx) + irq / 32;
+
+    if (on) {
+        *en |= 1U << (irq % 32);
+    } else {
+        *en &= ~(1U << (irq % 32));
+    }
+}
+
+int plic_set_affinity(int irq, uint32_t mask) {
+    if (plic_base == 0 || irq <= 0 || (uint32_t)irq > plic_ndev) {
+        return -1;
+    }
+
+    // 去掉不存在或没有S模式上下文的cpu
+    mask &= (1U << nr_cpus) - 1;
+    for (int c = 0; c < nr_cpus; c++) {
+        if (plic_ctx[c] < 0) {
+            mask &= ~(1U << c);
+        }
+    }
+    if (mask == 0) {
+        return -1;
+    }
+
+    spin_lock(&plic_lock);
+    // 先使能新加入的上下文再关闭移出的，切换过程中总有hart能认领
+    for (int c = 0; c < nr_cpus; c++) {
+        if (mask & (1U << c)) {
+            plic_enable(plic_ctx[c], irq, 1);
+        }
+    }
+    for (int c = 0; c < nr_cpus; c++) {
+        if (plic_ctx[c] >= 0 && !(mask & (1U << c))) {
+            plic_enable(plic_ctx[c], irq, 0);
+        }
+    }
+    irq_table[irq].affinity = mask;
+    spin_unlock(&plic_lock);
+    return 0;
+}
+
+// 初始亲和性为注册时所在的hart，之后可用plic_set_affinity调整
+int plic_register_irq(int irq, irq_handler_t handler, void *arg) {
+    if (plic_base == 0 || irq <= 0 || (uint32_t)irq > plic_ndev || plic_ctx[cpuid()] < 0) {
+        return -1;
+    }
+
+    irq_table[irq].handler = handler;
+    irq_table[irq].arg = arg;
+
+    PLIC_REG(PLIC_PRIORITY(irq)) = 1;
+    return plic_set_affinity(irq, 1U << cpuid());
+}
+
+void plic_handle_irq(void) {
+    int ctx = plic_ctx[cpuid()];
+    if (ctx < 0) {
+        return;
+    }
+
+    struct plic_stat *st = &plic_stats[cpuid()];
+    uint64_t n = 0;
+    for (;;) {
+        uint32_t irq = PLIC_REG(PLIC_CLAIM(ctx));
+        if (irq == 0) {
+            break;
+        }
+        if (irq < PLIC_MAX_IRQ && irq_table[irq].handler) {
+            irq_table[irq].count++;
+            irq_table[irq].handler(irq, irq_table[irq].arg);
+        }
+        PLIC_REG(PLIC_CLAIM(ctx)) = irq;
+        n++;
+    }
+
+    st->traps++;
+    st->claims += n;
+    if (n == 0) {
+        st->spurious++;
+    }
+    if (n > st->max_batch) {
+        st->max_batch = n;
+    }
+}
+
+void plic_dump(void) {
+    pr_info("=== PLIC统计 ===\n");
+    pr_info("cpu / 上下文 / 陷入 / 认领 / 空认领 / 单次最多\n");
+    for (int c = 0; c < nr_cpus; c++) {
+        struct plic_stat *st = &plic_stats[c];
+        pr_info("cpu%d / %d / %lu / %lu / %lu / %lu\n", c, plic_ctx[c],
+                st->traps, st->claims, st->spurious, st->max_batch);
+    }
+    for (int i = 1; i < PLIC_MAX_IRQ; i++) {
+        if (irq_table[i].handler != NULL) {
+            pr_info("irq%d: 亲和性 0x%x, 处理 %lu 次\n", i, irq_table[i].affinity, irq_table[i].count);
+        }
+    }
+}
@@ -0,0 +1,324 @@
+#include "kernel.h"
+#include "riscv.h"
+#include "fdt.h"
+#include "pmm.h"
+#include "spinlock.h"
+
+// 物理页帧分配器（伙伴系统）
+// 空闲块的链表节点直接存放在空闲块自身的首部，另用每页一字节的frame_state
+// 记录块头状态，因此判断伙伴是否空闲、从链表摘除都是O(1)，分配/释放为O(MAX_ORDER)。
+
+#define PMM_MAX_REGIONS     16
+
+#define FRAME_TAIL          0x00    // 块内非首页
+#define FRAME_ALLOC         0x40    // 已分配块头，低位为阶
+#define FRAME_FREE          0x80    // 空闲块头，低位为阶
+#define FRAME_RESERVED      0xff    // 不归分配器管理（空洞/保留区）
+#define FRAME_ORDER_MASK    0x1f
+
+struct free_block {
+    struct free_block *next;
+    struct free_block *prev;
+};
+
+struct free_area {
+    struct free_block head;
+    uint64_t nr_free;
+};
+
+static struct free_area free_area[PMM_MAX_ORDER + 1];
+static uint8_t *frame_state;
+static uint64_t pfn_base;       // 按最大阶对齐，保证伙伴下标可直接异或
+static uint64_t pfn_count;
+static uint64_t nr_free_pages;
+static uint64_t nr_total_pages;
+// 多个hart同时建页表、建线程栈时竞争最激烈，用MCS锁让等待者各自在栈上的节点自旋
+static struct mcs_lock pmm_lock = MCS_LOCK_INIT("pmm");
+
+static struct mem_region mem_regions[PMM_MAX_REGIONS];
+static int nr_mem_regions;
+static struct mem_region reserved[PMM_MAX_REGIONS];
+static int nr_reserved;
+
+static uint64_t boot_fdt_start, boot_fdt_end;
+static uint64_t early_top;
+static int pmm_ready;
+
+#define PFN(pa)         ((uint64_t)(pa) >> PAGE_SHIFT)
+#define IDX_TO_PA(idx)  ((pfn_base + (idx)) << PAGE_SHIFT)
+#define PA_TO_IDX(pa)   (PFN(pa) - pfn_base)
+
+static inline void list_init(struct free_block *head) {
+    head->next = head;
+    head->prev = head;
+}
+
+static inline void list_add(struct free_block *head, struct free_block *node) {
+    node->next = head->next;
+    node->prev = head;
+    head->next->prev = node;
+    head->next = node;
+}
+
+static inline void list_del(struct free_block *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+}
+
+void pmm_early_init(uint64_t fdt_addr) {
+    const struct fdt_header *fdt = __va(fdt_addr);
+
+    boot_fdt_start = PAGE_ROUND_DOWN(fdt_addr);
+    boot_fdt_end = PAGE_ROUND_UP(fdt_addr + be32_to_cpu(fdt->totalsize));
+    early_top = PAGE_ROUND_UP(__pa(_end));
+}
+
+void *pmm_early_alloc(uint64_t size) {
+    if (pmm_ready || early_top == 0) {
+        return NULL;
+    }
+
+    size = PAGE_ROUND_UP(size);
+    // 跳过FDT所在区域
+    if (early_top < boot_fdt_end && early_top + size > boot_fdt_start) {
+        early_top = boot_fdt_end;
+    }
+
+    void *p = __va(early_top);
+    early_top += size;
+    return p;
+}
+
+static void add_reserved(uint64_t base, uint64_t size) {
+    if (nr_reserved < PMM_MAX_REGIONS && size != 0) {
+        reserved[nr_reserved].base = base;
+        reserved[nr_reserved].size = size;
+        nr_reserved++;
+    }
+}
+
+// 保留区按基址排序，便于线性地从内存区间中扣除
+static void sort_reserved(void) {
+    for (int i = 1; i < nr_reserved; i++) {
+        struct mem_region r = reserved[i];
+        int j = i - 1;
+        while (j >= 0 && reserved[j].base > r.base) {
+            reserved[j + 1] = reserved[j];
+            j--;
+        }
+        reserved[j + 1] = r;
+    }
+}
+
+// 以idx为首、阶为order的块放回空闲链表，并与空闲伙伴逐级合并
+static void free_block_merge(uint64_t idx, int order) {
+    frame_state[idx] = FRAME_TAIL;
+    while (order < PMM_MAX_ORDER) {
+        uint64_t buddy = idx ^ (1UL << order);
+        if (buddy >= pfn_count || frame_state[buddy] != (FRAME_FREE | order)) {
+            break;
+        }
+        list_del(__va(IDX_TO_PA(buddy)));
+        free_area[order].nr_free--;
+        frame_state[buddy] = FRAME_TAIL;
+        idx &= ~(1UL << order);
+        order++;
+    }
+
+    frame_state[idx] = FRAME_FREE | order;
+    list_add(&free_area[order].head, __va(IDX_TO_PA(idx)));
+    free_area[order].nr_free++;
+}
+
+// 把[start, end)按最大的对齐块加入伙伴系统
+static void add_free_range(uint64_t start, uint64_t end) {
+    start = PAGE_ROUND_UP(start);
+    end = PAGE_ROUND_DOWN(end);
+    if (start >= end) {
+        return;
+    }
+
+    uint64_t idx = PA_TO_IDX(start);
+    uint64_t last = PA_TO_IDX(end);
+    memset(frame_state + idx, FRAME_TAIL, last - idx);
+    nr_free_pages += last - idx;
+
+    while (idx < last) {
+        int order = PMM_MAX_ORDER;
+        while (order > 0 && ((idx & ((1UL << order) - 1)) || idx + (1UL << order) > last)) {
+            order--;
+        }
+        free_block_merge(idx, order);
+        idx += 1UL << order;
+    }
+}
+
+int pmm_init(void) {
+    puts("=== 初始化物理页分配器 ===\n");
+
+    nr_mem_regions = fdt_get_memory(mem_regions, PMM_MAX_REGIONS);
+    if (nr_mem_regions <= 0) {
+        puts("错误: 设备树中没有/memory节点\n");
+        return -1;
+    }
+
+    int n = fdt_get_reserved(reserved, PMM_MAX_REGIONS);
+    nr_reserved = n < 0 ? 0 : n;
+
+    uint64_t lo = UINT64_MAX, hi = 0;
+    for (int i = 0; i < nr_mem_regions; i++) {
+        uint64_t b = mem_regions[i].base;
+        uint64_t e = b + mem_regions[i].size;
+        puts("内存区间: ");
+        print_hex(b);
+        puts(" - ");
+        print_hex(e);
+        puts("\n");
+        if (b < lo) lo = b;
+        if (e > hi) hi = e;
+    }
+
+    pfn_base = PFN(lo) & ~((1UL << PMM_MAX_ORDER) - 1);
+    pfn_count = PFN(PAGE_ROUND_UP(hi)) - pfn_base;
+
+    // 页帧状态表本身来自早期分配，随后内核镜像到early_top整体保留
+    frame_state = pmm_early_alloc(pfn_count);
+    memset(frame_state, FRAME_RESERVED, pfn_count);
+    pmm_ready = 1;
+
+    add_reserved(__pa(_kernel_start), early_top - __pa(_kernel_start));
+    add_reserved(boot_fdt_start, boot_fdt_end - boot_fdt_start);
+    sort_reserved();
+
+    for (int i = 0; i <= PMM_MAX_ORDER; i++) {
+        list_init(&free_area[i].head);
+    }
+
+    for (int i = 0; i < nr_mem_regions; i++) {
+        uint64_t cur = mem_regions[i].base;
+        uint64_t end = cur + mem_regions[i].size;
+
+        for (int j = 0; j < nr_reserved && cur < end; j++) {
+            uint64_t rb = reserved[j].base;
+            uint64_t re = rb + reserved[j].size;
+            if (re <= cur || rb >= end) {
+                continue;
+            }
+            if (rb > cur) {
+                add_free_range(cur, rb);
+            }
+            if (re > cur) {
+                cur = re;
+            }
+        }
+        if (cur < end) {
+            add_free_range(cur, end);
+        }
+    }
+    nr_total_pages = nr_free_pages;
+
+    pmm_dump();
+    puts("✓ 物理页分配器初始化完成\n\n");
+    return 0;
+}
+
+void *alloc_pages(int order) {
+    if (order < 0 || order > PMM_MAX_ORDER) {
+        return NULL;
+    }
+
+    struct mcs_node node;
+    push_off();
+    mcs_acquire(&pmm_lock, &node);
+    int o = order;
+    while (o <= PMM_MAX_ORDER && free_area[o].nr_free == 0) {
+        o++;
+    }
+    if (o > PMM_MAX_ORDER) {
+        mcs_release(&pmm_lock, &node);
+        pop_off();
+        return NULL;
+    }
+
+    struct free_block *blk = free_area[o].head.next;
+    list_del(blk);
+    free_area[o].nr_free--;
+    uint64_t idx = PA_TO_IDX(__pa(blk));
+
+    // 逐级拆分，后半块挂回低一阶的链表
+    while (o > order) {
+        o--;
+        uint64_t buddy = idx + (1UL << o);
+        frame_state[buddy] = FRAME_FREE | o;
+        list_add(&free_area[o].head, __va(IDX_TO_PA(buddy)));
+        free_area[o].nr_free++;
+    }
+
+    frame_state[idx] = FRAME_ALLOC | order;
+    nr_free_pages -= 1UL << order;
+    mcs_release(&pmm_lock, &node);
+    pop_off();
+    return blk;
+}
+
+void free_pages(void *addr, int order) {
+    uint64_t pa = __pa(addr);
+    uint64_t idx = PA_TO_IDX(pa);
+
+    struct mcs_node node;
+
+    if (addr == NULL) {
+        return;
+    }
+    push_off();
+    mcs_acquire(&pmm_lock, &node);
+    if ((pa & (PAGE_SIZE - 1)) || PFN(pa) < pfn_base || idx >= pfn_count ||
+        frame_state[idx] != (FRAME_ALLOC | order)) {
+        puts("错误: free_pages参数非法 ");
+        print_hex(pa);
+        puts("\n");
+        mcs_release(&pmm_lock, &node);
+        pop_off();
+        return;
+    }
+
+    nr_free_pages += 1UL << order;
+    free_block_merge(idx, order);
+    mcs_release(&pmm_lock, &node);
+    pop_off();
+}
+
+int pmm_block_order(void *addr) {
+    uint64_t pa = __pa(addr);
+    uint64_t idx = PA_TO_IDX(pa);
+
+    if ((pa & (PAGE_SIZE - 1)) || PFN(pa) < pfn_base || idx >= pfn_count) {
+        return -1;
+    }
+    uint8_t st = frame_state[idx];
+    if (st == FRAME_RESERVED || !(st & FRAME_ALLOC)) {
+        return -1;
+    }
+    return st & FRAME_ORDER_MASK;
+}
+
+uint64_t pmm_mem_end(void) {
+    return (pfn_base + pfn_count) << PAGE_SHIFT;
+}
+
+uint64_t pmm_free_pages(void) {
+    return nr_free_pages;
+}
+
+void pmm_dump(void) {
+    puts("页帧: 总计=");
+    print_dec(nr_total_pages);
+    puts(" 空闲=");
+    print_dec(nr_free_pages);
+    puts("\n各阶空闲块:");
+    for (int i = 0; i <= PMM_MAX_ORDER; i++) {
+        puts(" ");
+        print_dec(free_area[i].nr_free);
+    }
+    puts("\n");
+}
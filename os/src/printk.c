@@ -0,0 +1,250 @@
+#include "kernel.h"
+#include "riscv.h"
+#include "cpu.h"
+#include "sbi.h"
+#include "spinlock.h"
+#include "console.h"
+#include "printk.h"
+#include "printf.h"
+#include "timer.h"
+
+// 内核日志
+// 每个hart有自己的日志环：本hart是唯一生产者，写记录时只关本地中断，不加锁；
+// 输出方持有drain_lock，是唯一消费者。head/tail各自只有一方写，
+// 用fence发布即可做到无锁。输出时按rdtime时间戳把各hart的记录归并，
+// 所以多核的日志在控制台上仍然是时间顺序的。
+// 已输出的记录在被覆盖前仍保留在环中，供异常后dmesg重放。
+
+#define LOG_F_CONT      0x01    // 续行：上一条记录没有以换行结束
+
+struct log_record {
+    uint64_t ts;
+    uint16_t len;
+    uint8_t level;
+    uint8_t flags;
+    uint32_t hart;
+    char text[LOG_TEXT_MAX];
+};
+
+struct log_ring {
+    volatile uint64_t head;     // 生产者写
+    uint64_t pad0[7];
+    volatile uint64_t tail;     // 消费者写
+    uint64_t pad1[7];
+    struct log_record cur;      // 正在拼接的行，只有本hart访问
+    int cont;
+    struct log_record slots[LOG_RING_SLOTS];
+} __attribute__((aligned(64)));
+
+_Static_assert(sizeof(struct log_record) == 128, "log record must be two cache lines");
+
+#define LOG_HDR_SIZE    (sizeof(struct log_record) - LOG_TEXT_MAX)
+#define LOG_LINE_MAX    (LOG_TEXT_MAX + 32)
+
+typedef void (*log_emit_t)(const char *s, int len);
+
+int printk_level = LOG_DEFAULT;
+
+static struct log_ring log_rings[NCPU];
+static struct spinlock drain_lock = SPINLOCK_INIT("printk");
+static int line_open = -1;                  // 控制台上未结束的行属于哪个hart
+// 拼行缓冲放在内核镜像里而不是栈上：线程栈在懒分配区，物理上不连续，
+// DBCN拿不到它的物理地址。与line_open一样由drain_lock保护（panic路径除外）
+static char emit_line[LOG_LINE_MAX];
+
+// 把拼好的行写入环中，调用者已关闭本地中断
+static void log_commit(struct log_ring *r) {
+    // 环里全是未输出的记录：就地输出一轮腾出空间，不丢日志
+    if (r->head - r->tail == LOG_RING_SLOTS) {
+        printk_flush();
+    }
+
+    struct log_record *slot = &r->slots[r->head % LOG_RING_SLOTS];
+    memcpy(slot, &r->cur, LOG_HDR_SIZE + r->cur.len);
+    asm volatile("fence w, w" ::: "memory");
+    r->head++;
+    r->cur.len = 0;
+}
+
+void printk_write(int level, const char *s, int len) {
+    if (!printk_enabled(level)) {
+        return;
+    }
+
+    uint64_t flags = local_irq_save();
+    int id = cpuid();
+    struct log_ring *r = &log_rings[id];
+
+    while (len > 0) {
+        if (r->cur.len == 0) {
+            // 续行沿用行首的时间戳，归并时紧跟在前半行之后
+            if (!r->cont) {
+                r->cur.ts = rdtime();
+            }
+            r->cur.level = level;
+            r->cur.flags = r->cont ? LOG_F_CONT : 0;
+            r->cur.hart = cpus[id].hartid;
+        }
+
+        char c = *s++;
+        len--;
+        r->cur.text[r->cur.len++] = c;
+        if (c == '\n') {
+            log_commit(r);
+            r->cont = 0;
+        } else if (r->cur.len == LOG_TEXT_MAX) {
+            log_commit(r);
+            r->cont = 1;
+        }
+    }
+    local_irq_restore(flags);
+}
+
+void printk(int level, const char *fmt, ...) {
+    char buf[PRINTK_FMT_MAX];
+    va_list ap;
+
+    if (!printk_enabled(level)) {
+        return;
+    }
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+
+    printk_write(level, buf, n < (int)sizeof(buf) ? n : (int)sizeof(buf) - 1);
+}
+
+// 输出一条记录：行首加"[秒.微秒 hN] "前缀，整行一次交给后端
+static void log_emit_record(const struct log_record *rec, log_emit_t emit) {
+    char *line = emit_line;
+    int n = 0;
+
+    if (line_open >= 0 && (uint32_t)line_open != rec->hart) {
+        line[n++] = '\n';
+        line_open = -1;
+    }
+    if (!(rec->flags & LOG_F_CONT) || line_open < 0) {
+        uint64_t sec, usec;
+        ticks_to_sec_us(rec->ts, &sec, &usec);
+        n += snprintf(line + n, sizeof(emit_line) - n, "[%5lu.%06lu h%u] ", sec, usec, rec->hart);
+    }
+    memcpy(line + n, rec->text, rec->len);
+    n += rec->len;
+
+    line_open = rec->text[rec->len - 1] == '\n' ? -1 : (int)rec->hart;
+    emit(line, n);
+}
+
+// 在各hart的[pos[i], end[i])中按时间戳归并输出
+static void log_merge(uint64_t *pos, const uint64_t *end, log_emit_t emit) {
+    for (;;) {
+        int best = -1;
+        uint64_t best_ts = UINT64_MAX;
+
+        for (int i = 0; i < NCPU; i++) {
+            if (pos[i] == end[i]) {
+                continue;
+            }
+            const struct log_record *rec = &log_rings[i].slots[pos[i] % LOG_RING_SLOTS];
+            if (rec->ts < best_ts) {
+                best_ts = rec->ts;
+                best = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+
+        log_emit_record(&log_rings[best].slots[pos[best] % LOG_RING_SLOTS], emit);
+        pos[best]++;
+    }
+}
+
+// 输出所有未输出的记录，调用者持有drain_lock（panic路径除外）
+static void drain_locked(log_emit_t emit) {
+    uint64_t pos[NCPU], end[NCPU];
+
+    for (int i = 0; i < NCPU; i++) {
+        pos[i] = log_rings[i].tail;
+        end[i] = log_rings[i].head;
+    }
+    asm volatile("fence r, r" ::: "memory");
+
+    log_merge(pos, end, emit);
+
+    // 记录读完才归还槽位
+    asm volatile("fence rw, w" ::: "memory");
+    for (int i = 0; i < NCPU; i++) {
+        log_rings[i].tail = end[i];
+    }
+}
+
+void printk_drain(void) {
+    if (!spin_trylock(&drain_lock)) {
+        return;
+    }
+    drain_locked(console_write);
+    spin_unlock(&drain_lock);
+}
+
+void printk_flush(void) {
+    spin_lock(&drain_lock);
+    drain_locked(console_write);
+    spin_unlock(&drain_lock);
+}
+
+// 异常路径使用：不加锁，轮询输出，重放后所有记录视为已输出
+void dmesg(void) {
+    uint64_t pos[NCPU], end[NCPU];
+
+    for (int i = 0; i < NCPU; i++) {
+        end[i] = log_rings[i].head;
+        pos[i] = end[i] > LOG_RING_SLOTS ? end[i] - LOG_RING_SLOTS : 0;
+    }
+    asm volatile("fence r, r" ::: "memory");
+
+    const char *hdr = "\n=== dmesg ===\n";
+    console_write_sync(hdr, strlen(hdr));
+    line_open = -1;
+    log_merge(pos, end, console_write_sync);
+    if (line_open >= 0) {
+        console_write_sync("\n", 1);
+        line_open = -1;
+    }
+    for (int i = 0; i < NCPU; i++) {
+        log_rings[i].tail = end[i];
+    }
+}
+
+// 字符串和输出函数
+void puts(const char *s) {
+    printk_write(LOG_DEFAULT, s, strlen(s));
+}
+
+void print_hex(uint64_t value) {
+    printk(LOG_DEFAULT, "0x%016lx", value);
+}
+
+void print_dec(uint64_t value) {
+    printk(LOG_DEFAULT, "%lu", value);
+}
+
+// 致命错误：先轮询输出日志环中剩余的记录，再输出错误信息并关机
+void panic(const char *msg) {
+    local_irq_save();
+
+    // 此时可能有别的hart持有drain_lock，只能不加锁直接输出
+    struct log_ring *r = &log_rings[cpuid()];
+    drain_locked(console_write_sync);
+    if (r->cur.len != 0) {
+        r->cur.text[r->cur.len++] = '\n';
+        log_commit(r);
+        drain_locked(console_write_sync);
+    }
+
+    console_write_sync("panic: ", 7);
+    console_write_sync(msg, strlen(msg));
+    console_write_sync("\n", 1);
+    sbi_shutdown();
+    while (1) {}
+}
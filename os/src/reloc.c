@@ -0,0 +1,95 @@
+#include "kernel.h"
+#include "printk.h"
+#include "reloc.h"
+
+// ELF重定位条目与动态符号表条目
+typedef struct {
+    uint64_t r_offset;     // 重定位位置（链接地址）
+    uint64_t r_info;       // 类型和符号索引
+    int64_t  r_addend;     // 加数
+} Elf64_Rela;
+
+typedef struct {
+    uint32_t st_name;
+    uint8_t  st_info;
+    uint8_t  st_other;
+    uint16_t st_shndx;     // 0表示未定义
+    uint64_t st_value;
+    uint64_t st_size;
+} Elf64_Sym;
+
+#define ELF64_R_SYM(info)   ((info) >> 32)
+#define ELF64_R_TYPE(info)  ((info) & 0xffffffff)
+
+#define R_RISCV_NONE        0
+#define R_RISCV_32          1
+#define R_RISCV_64          2
+#define R_RISCV_RELATIVE    3
+#define R_RISCV_JUMP_SLOT   5
+
+// 链接脚本定义；隐藏可见性保证用PC相对寻址而不是经GOT取地址
+#define HIDDEN __attribute__((visibility("hidden")))
+extern Elf64_Rela __rela_dyn_start[] HIDDEN;
+extern Elf64_Rela __rela_dyn_end[] HIDDEN;
+extern Elf64_Sym __dynsym_start[] HIDDEN;
+extern Elf64_Sym __dynsym_end[] HIDDEN;
+
+// 重定位时写入，kernel_main里才打印
+static uint64_t reloc_count[R_RISCV_JUMP_SLOT + 1];
+static uint64_t reloc_unresolved;
+static uint64_t reloc_bias;
+
+// 按符号索引取运行时地址；未定义符号返回0
+static uint64_t resolve_symbol(const Elf64_Rela *rela, uint64_t load_bias) {
+    uint64_t idx = ELF64_R_SYM(rela->r_info);
+    uint64_t nsyms = __dynsym_end - __dynsym_start;
+
+    if (idx == 0 || idx >= nsyms || __dynsym_start[idx].st_shndx == 0) {
+        return 0;
+    }
+    return __dynsym_start[idx].st_value + load_bias;
+}
+
+// 与doc/resolve_symbol.c中的process_relocations相同，只是不能用switch：
+// 跳转表本身可能需要重定位
+static void process_relocations(Elf64_Rela *rela_start, Elf64_Rela *rela_end, uint64_t load_bias) {
+    for (Elf64_Rela *rela = rela_start; rela < rela_end; rela++) {
+        uint64_t type = ELF64_R_TYPE(rela->r_info);
+        uint64_t *target = (uint64_t *)(rela->r_offset + load_bias);
+
+        if (type == R_RISCV_RELATIVE) {
+            *target = rela->r_addend + load_bias;
+        } else if (type == R_RISCV_64 || type == R_RISCV_32 || type == R_RISCV_JUMP_SLOT) {
+            uint64_t sym_addr = resolve_symbol(rela, load_bias);
+            if (sym_addr == 0) {
+                reloc_unresolved++;
+                continue;
+            }
+            if (type == R_RISCV_64) {
+                *target = sym_addr + rela->r_addend;
+            } else if (type == R_RISCV_32) {
+                *(uint32_t *)target = (uint32_t)(sym_addr + rela->r_addend);
+            } else {
+                *target = sym_addr;
+            }
+        } else if (type != R_RISCV_NONE) {
+            reloc_unresolved++;
+            continue;
+        }
+        reloc_count[type]++;
+    }
+}
+
+void relocate_kernel(uint64_t load_bias) {
+    reloc_bias = load_bias;
+    process_relocations(__rela_dyn_start, __rela_dyn_end, load_bias);
+}
+
+void reloc_dump(void) {
+    pr_info("重定位: bias=0x%lx RELATIVE=%lu 64=%lu 32=%lu JUMP_SLOT=%lu 无法处理=%lu\n",
+            reloc_bias, reloc_count[R_RISCV_RELATIVE], reloc_count[R_RISCV_64],
+            reloc_count[R_RISCV_32], reloc_count[R_RISCV_JUMP_SLOT], reloc_unresolved);
+    if (reloc_unresolved != 0) {
+        panic("内核重定位不完整");
+    }
+}
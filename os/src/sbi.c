@@ -0,0 +1,55 @@
+#include "sbi.h"
+
+// SBI服务接口
+void sbi_console_putchar(int ch) {
+    sbi_ecall(SBI_CONSOLE_PUTCHAR, 0, ch, 0, 0, 0, 0, 0);
+}
+
+struct sbiret sbi_get_spec_version(void) {
+    return sbi_ecall(SBI_EXT_BASE, 0, 0, 0, 0, 0, 0, 0);
+}
+
+struct sbiret sbi_get_impl_id(void) {
+    return sbi_ecall(SBI_EXT_BASE, 1, 0, 0, 0, 0, 0, 0);
+}
+
+struct sbiret sbi_probe_extension(long extension_id) {
+    return sbi_ecall(SBI_EXT_BASE, 3, extension_id, 0, 0, 0, 0, 0);
+}
+
+void sbi_set_timer(uint64_t stime_value) {
+    sbi_ecall(SBI_EXT_TIME, 0, stime_value, 0, 0, 0, 0, 0);
+}
+
+void sbi_shutdown(void) {
+    sbi_ecall(SBI_SHUTDOWN, 0, 0, 0, 0, 0, 0, 0);
+    while (1) {}
+}
+
+struct sbiret sbi_hart_start(uint64_t hartid, uint64_t start_addr, uint64_t opaque) {
+    return sbi_ecall(SBI_EXT_HSM, 0, hartid, start_addr, opaque, 0, 0, 0);
+}
+
+struct sbiret sbi_hart_get_status(uint64_t hartid) {
+    return sbi_ecall(SBI_EXT_HSM, 2, hartid, 0, 0, 0, 0, 0);
+}
+
+// base_addr为物理地址，返回值value为实际写出的字节数
+struct sbiret sbi_debug_console_write(uint64_t num_bytes, uint64_t base_addr) {
+    return sbi_ecall(SBI_EXT_DBCN, 0, num_bytes, base_addr, 0, 0, 0, 0);
+}
+
+// hart_mask的第i位对应hartid = hart_mask_base + i
+struct sbiret sbi_send_ipi(uint64_t hart_mask, uint64_t hart_mask_base) {
+    return sbi_ecall(SBI_EXT_IPI, 0, hart_mask, hart_mask_base, 0, 0, 0, 0);
+}
+
+struct sbiret sbi_remote_sfence_vma(uint64_t hart_mask, uint64_t hart_mask_base,
+                                    uint64_t start, uint64_t size) {
+    return sbi_ecall(SBI_EXT_RFENCE, 1, hart_mask, hart_mask_base, start, size, 0, 0);
+}
+
+struct sbiret sbi_remote_sfence_vma_asid(uint64_t hart_mask, uint64_t hart_mask_base,
+                                         uint64_t start, uint64_t size, uint64_t asid) {
+    return sbi_ecall(SBI_EXT_RFENCE, 2, hart_mask, hart_mask_base, start, size, asid, 0);
+}
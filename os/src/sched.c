@@ -0,0 +1,332 @@
+#include "kernel.h"
+#include "riscv.h"
+#include "sbi.h"
+#include "cpu.h"
+#include "pmm.h"
+#include "slab.h"
+#include "printk.h"
+#include "timer.h"
+#include "sched.h"
+#include "mm.h"
+#include "vmem.h"
+
+// 调度器
+// 每个hart有一个独立的运行队列，调度路径上没有全局锁：
+//   - 线程只由本hart在关中断时放入本hart队列的尾部（新建、让出、被抢占、被定时器唤醒）；
+//   - 本hart和其他hart都用CAS从队列头部取线程，本地取走的是最早入队的线程，
+//     被抢占的线程排到队尾，从而在本hart内轮转；空闲hart从别的hart队列头部窃取。
+// 队列是Chase-Lev工作窃取双端队列的变体（去掉了尾部弹出），头尾都是单调递增的64位下标。
+// 调度循环运行在每个hart自己的启动栈上，始终关中断；线程只通过swtch进出调度循环。
+
+struct wsdeque {
+    volatile int64_t top;               // 取出端，多个hart竞争
+    uint64_t pad0[7];
+    volatile int64_t bottom;            // 放入端，只有所属hart写
+    uint64_t pad1[7];
+    struct thread *buf[WSQ_SIZE];
+};
+
+struct runqueue {
+    struct wsdeque dq;
+    struct context sched_ctx;           // 调度循环的上下文
+    struct thread *current;
+    volatile int idle;                  // 正在wfi，放入线程后需要IPI唤醒
+    volatile int need_resched;
+    struct timer slice_timer;
+    uint64_t nr_switches;
+    uint64_t nr_preempts;
+    uint64_t nr_steals;
+    uint64_t nr_idle;
+} __attribute__((aligned(64)));
+
+static struct runqueue runqueues[NCPU];
+static volatile int next_tid = 1;
+
+static inline struct runqueue *this_rq(void) {
+    return &runqueues[cpuid()];
+}
+
+// 只能由队列所属hart在关中断时调用
+static void wsq_push(struct wsdeque *q, struct thread *t) {
+    int64_t b = q->bottom;
+    int64_t top = __atomic_load_n(&q->top, __ATOMIC_ACQUIRE);
+
+    if (b - top >= WSQ_SIZE) {
+        panic("sched: 运行队列已满");
+    }
+    q->buf[b & (WSQ_SIZE - 1)] = t;
+    // 先写入槽位再发布新的bottom
+    __atomic_store_n(&q->bottom, b + 1, __ATOMIC_RELEASE);
+}
+
+// 任意hart都可调用；队列为空或与其他hart竞争失败时返回NULL
+static struct thread *wsq_take(struct wsdeque *q) {
+    int64_t top = __atomic_load_n(&q->top, __ATOMIC_ACQUIRE);
+    int64_t b = __atomic_load_n(&q->bottom, __ATOMIC_ACQUIRE);
+
+    if (top >= b) {
+        return NULL;
+    }
+    // 读槽位必须在CAS之前：CAS成功后所属hart可能立即复用该槽位
+    struct thread *t = __atomic_load_n(&q->buf[top & (WSQ_SIZE - 1)], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&q->top, &top, top + 1, 0,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+    return t;
+}
+
+static inline int wsq_empty(struct wsdeque *q) {
+    return __atomic_load_n(&q->top, __ATOMIC_ACQUIRE) >=
+           __atomic_load_n(&q->bottom, __ATOMIC_ACQUIRE);
+}
+
+// 唤醒一个空闲的hart来窃取刚放入的线程
+static void sched_kick(void) {
+    int self = cpuid();
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (int i = 1; i < nr_cpus; i++) {
+        int c = (self + i) % nr_cpus;
+        if (runqueues[c].idle) {
+            sbi_send_ipi(1, cpus[c].hartid);
+            return;
+        }
+    }
+}
+
+// 放入当前hart的运行队列，调用者已关中断
+static void sched_enqueue(struct thread *t) {
+    t->state = THREAD_RUNNABLE;
+    wsq_push(&this_rq()->dq, t);
+    sched_kick();
+}
+
+// 先取本hart队列，再从下一个hart开始依次窃取
+static struct thread *pick_next(struct runqueue *rq) {
+    int self = rq - runqueues;
+    struct thread *t = wsq_take(&rq->dq);
+
+    if (t != NULL) {
+        return t;
+    }
+    for (int i = 1; i < nr_cpus; i++) {
+        t = wsq_take(&runqueues[(self + i) % nr_cpus].dq);
+        if (t != NULL) {
+            rq->nr_steals++;
+            return t;
+        }
+    }
+    return NULL;
+}
+
+static int has_work(void) {
+    for (int i = 0; i < nr_cpus; i++) {
+        if (!wsq_empty(&runqueues[i].dq)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 没有可运行线程：先声明空闲再复查所有队列，放入线程的一方先发布再检查idle，
+// 两边都有全屏障，因此不会出现双方都没看到对方的情况
+static void sched_idle(struct runqueue *rq) {
+    // 空闲时不再挂着用户地址空间的页表，它可能随即被销毁
+    switch_mm(&init_mm);
+    rq->idle = 1;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!has_work()) {
+        rq->nr_idle++;
+        printk_drain();
+        asm volatile("wfi");
+        csr_set(sstatus, SSTATUS_SIE);
+        csr_clear(sstatus, SSTATUS_SIE);
+    }
+    rq->idle = 0;
+}
+
+static void slice_expired(struct timer *t) {
+    struct runqueue *rq = t->data;
+    rq->need_resched = 1;
+}
+
+void sched_run(void) {
+    local_irq_save();
+    struct runqueue *rq = this_rq();
+
+    for (;;) {
+        struct thread *t = pick_next(rq);
+        if (t == NULL) {
+            sched_idle(rq);
+            continue;
+        }
+
+        rq->current = t;
+        rq->need_resched = 0;
+        rq->nr_switches++;
+        t->state = THREAD_RUNNING;
+        t->last_cpu = cpuid();
+        t->nr_runs++;
+        timer_add(&rq->slice_timer, rdtime() + ms_to_ticks(SCHED_SLICE_MS));
+        switch_mm(t->mm != NULL ? t->mm : &init_mm);
+
+        swtch(&rq->sched_ctx, &t->ctx);
+
+        // 线程已经离开CPU，它的栈现在可以交给其他hart
+        timer_cancel(&rq->slice_timer);
+        rq->current = NULL;
+        switch (t->state) {
+        case THREAD_RUNNABLE: {
+            // 队列里还有别的线程时才叫醒空闲hart，只有一个线程就留在本hart继续跑
+            int busy = !wsq_empty(&rq->dq);
+            wsq_push(&rq->dq, t);
+            if (busy) {
+                sched_kick();
+            }
+            break;
+        }
+        case THREAD_EXITING:
+            __atomic_store_n(&t->state, THREAD_ZOMBIE, __ATOMIC_RELEASE);
+            break;
+        default:
+            // THREAD_BLOCKED：由唤醒方重新放入队列
+            break;
+        }
+    }
+}
+
+// 切回调度循环，调用者已关中断；返回时线程可能已迁移到其他hart
+static void sched_switch(struct thread *t, int state) {
+    if (mycpu()->noff != 0) {
+        panic("sched: 持有自旋锁时切换线程");
+    }
+    t->state = state;
+    swtch(&t->ctx, &this_rq()->sched_ctx);
+}
+
+int sched_preempt_check(void) {
+    struct runqueue *rq = this_rq();
+    return rq->current != NULL && rq->need_resched;
+}
+
+// 中断出口，已在线程栈上、关中断
+void sched_preempt(void) {
+    struct runqueue *rq = this_rq();
+
+    rq->nr_preempts++;
+    sched_switch(rq->current, THREAD_RUNNABLE);
+}
+
+void sched_yield(void) {
+    uint64_t flags = local_irq_save();
+    struct thread *t = this_rq()->current;
+
+    if (t != NULL) {
+        sched_switch(t, THREAD_RUNNABLE);
+    }
+    local_irq_restore(flags);
+}
+
+void thread_set_mm(struct mm *mm) {
+    uint64_t flags = local_irq_save();
+    struct thread *t = this_rq()->current;
+
+    t->mm = mm;
+    switch_mm(mm != NULL ? mm : &init_mm);
+    local_irq_restore(flags);
+}
+
+struct thread *sched_current(void) {
+    uint64_t flags = local_irq_save();
+    struct thread *t = this_rq()->current;
+    local_irq_restore(flags);
+    return t;
+}
+
+// 定时器回调在挂入定时器的hart上执行，此时线程早已离开CPU
+static void sleep_expired(struct timer *tm) {
+    sched_enqueue(tm->data);
+}
+
+void thread_sleep(uint64_t ticks) {
+    uint64_t flags = local_irq_save();
+    struct thread *t = this_rq()->current;
+
+    // 关中断直到切回调度循环，定时器不会在线程离开CPU之前触发
+    timer_add(&t->sleep_timer, rdtime() + ticks);
+    sched_switch(t, THREAD_BLOCKED);
+    local_irq_restore(flags);
+}
+
+void thread_exit(void) {
+    local_irq_save();
+    sched_switch(this_rq()->current, THREAD_EXITING);
+    panic("sched: 已退出的线程被再次调度");
+}
+
+// 新线程从调度循环切入时仍是关中断状态
+static void thread_trampoline(void) {
+    struct thread *t = this_rq()->current;
+
+    csr_set(sstatus, SSTATUS_SIE);
+    t->fn(t->arg);
+    thread_exit();
+}
+
+struct thread *thread_create(const char *name, void (*fn)(void *arg), void *arg) {
+    struct thread *t = kzalloc(sizeof(*t));
+    if (t == NULL) {
+        return NULL;
+    }
+    // 线程栈放在vmem区域里，只为了栈底下方不映射的保护页；栈页本身预先分配：
+    // 线程可能在持有vmem_lock或pmm锁时用到新的栈页，缺页处理会在同一hart上重复加锁
+    t->stack = vmem_alloc(PAGE_SIZE << THREAD_STACK_ORDER, "stack");
+    if (t->stack == NULL) {
+        kfree(t);
+        return NULL;
+    }
+    if (vmem_populate(t->stack, PAGE_SIZE << THREAD_STACK_ORDER) != 0) {
+        vmem_free(t->stack);
+        kfree(t);
+        return NULL;
+    }
+
+    t->tid = __atomic_fetch_add(&next_tid, 1, __ATOMIC_RELAXED);
+    t->name = name;
+    t->fn = fn;
+    t->arg = arg;
+    t->last_cpu = -1;
+    t->ctx.ra = (uint64_t)thread_trampoline;
+    t->ctx.sp = (uint64_t)t->stack + (PAGE_SIZE << THREAD_STACK_ORDER);
+    timer_setup(&t->sleep_timer, sleep_expired, t);
+
+    uint64_t flags = local_irq_save();
+    sched_enqueue(t);
+    local_irq_restore(flags);
+    return t;
+}
+
+void thread_join(struct thread *t) {
+    while (__atomic_load_n(&t->state, __ATOMIC_ACQUIRE) != THREAD_ZOMBIE) {
+        sched_yield();
+    }
+    vmem_free(t->stack);
+    kfree(t);
+}
+
+void sched_init(void) {
+    for (int i = 0; i < NCPU; i++) {
+        timer_setup(&runqueues[i].slice_timer, slice_expired, &runqueues[i]);
+    }
+}
+
+void sched_dump(void) {
+    pr_info("=== 调度统计 ===\n");
+    pr_info("cpu / 切换 / 抢占 / 窃取 / 空闲\n");
+    for (int i = 0; i < nr_cpus; i++) {
+        struct runqueue *rq = &runqueues[i];
+        pr_info("cpu%d / %lu / %lu / %lu / %lu\n", i, rq->nr_switches,
+                rq->nr_preempts, rq->nr_steals, rq->nr_idle);
+    }
+}
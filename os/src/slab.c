@@ -0,0 +1,308 @@
+#include "kernel.h"
+#include "riscv.h"
+#include "cpu.h"
+#include "list.h"
+#include "pmm.h"
+#include "spinlock.h"
+#include "slab.h"
+
+// slab对象缓存
+// 每个slab占一页，页首是slab头，其后是等长对象，空闲对象通过首8字节串成链表。
+// 分配/释放先走当前hart的magazine（关本地中断即可，不加锁，只访问一条缓存行），
+// magazine空/满时才加锁与slab仓库批量交换一半对象。
+
+#define KMEM_MAX_CACHES     16
+#define KMEM_MAG_SIZE       7       // 64字节magazine：count + 7个指针
+#define KMEM_EMPTY_KEEP     1       // 每个缓存保留的空slab数，其余归还页分配器
+#define KMEM_MIN_SIZE       16
+#define KMEM_OBJ_OFFSET     64      // 对象区起始偏移（slab头按缓存行对齐）
+
+struct kmem_magazine {
+    uint64_t count;
+    void *objs[KMEM_MAG_SIZE];
+} __attribute__((aligned(64)));
+
+struct slab {
+    struct kmem_cache *cache;
+    struct list_head link;
+    void *freelist;
+    uint32_t inuse;
+    uint32_t total;
+};
+
+struct kmem_cache {
+    struct kmem_magazine mag[NCPU];
+    const char *name;
+    uint32_t obj_size;
+    uint32_t objs_per_slab;
+    struct spinlock lock;
+    struct list_head partial;
+    struct list_head full;
+    struct list_head empty;
+    uint64_t nr_slabs;
+    uint64_t nr_empty;
+    uint64_t slab_inuse;    // 已离开slab的对象数，包含magazine中缓存的
+    uint64_t nr_refill;
+    uint64_t nr_flush;
+} __attribute__((aligned(64)));
+
+_Static_assert(sizeof(struct kmem_magazine) == 64, "magazine must fit one cache line");
+_Static_assert(sizeof(struct slab) <= KMEM_OBJ_OFFSET, "slab header too large");
+
+static struct kmem_cache cache_pool[KMEM_MAX_CACHES];
+static int nr_caches;
+static struct spinlock cache_pool_lock = SPINLOCK_INIT("kmem_caches");
+
+// kmalloc尺寸分级：16 ~ 1024
+#define KMALLOC_NR_CLASSES  7
+static struct kmem_cache *kmalloc_caches[KMALLOC_NR_CLASSES];
+static const char *kmalloc_names[KMALLOC_NR_CLASSES] = {
+    "kmalloc-16", "kmalloc-32", "kmalloc-64", "kmalloc-128",
+    "kmalloc-256", "kmalloc-512", "kmalloc-1024",
+};
+
+static inline struct slab *obj_to_slab(void *obj) {
+    return (struct slab *)PAGE_ROUND_DOWN(obj);
+}
+
+struct kmem_cache *kmem_cache_create(const char *name, size_t size) {
+    if (size == 0 || size > KMALLOC_MAX_SIZE) {
+        return NULL;
+    }
+
+    spin_lock(&cache_pool_lock);
+    if (nr_caches >= KMEM_MAX_CACHES) {
+        spin_unlock(&cache_pool_lock);
+        return NULL;
+    }
+    struct kmem_cache *c = &cache_pool[nr_caches++];
+    spin_unlock(&cache_pool_lock);
+
+    if (size < KMEM_MIN_SIZE) {
+        size = KMEM_MIN_SIZE;
+    }
+    c->name = name;
+    c->obj_size = (size + 15) & ~15UL;
+    c->objs_per_slab = (PAGE_SIZE - KMEM_OBJ_OFFSET) / c->obj_size;
+    spin_lock_init(&c->lock, name);
+    list_init(&c->partial);
+    list_init(&c->full);
+    list_init(&c->empty);
+    return c;
+}
+
+// 新建一个slab并放入empty链表，调用者持有cache->lock
+static struct slab *slab_grow(struct kmem_cache *c) {
+    struct slab *s = alloc_page();
+    if (s == NULL) {
+        return NULL;
+    }
+
+    s->cache = c;
+    s->inuse = 0;
+    s->total = c->objs_per_slab;
+    s->freelist = NULL;
+
+    char *base = (char *)s + KMEM_OBJ_OFFSET;
+    for (int i = (int)s->total - 1; i >= 0; i--) {
+        void *obj = base + (uint64_t)i * c->obj_size;
+        *(void **)obj = s->freelist;
+        s->freelist = obj;
+    }
+
+    list_add(&c->empty, &s->link);
+    c->nr_slabs++;
+    c->nr_empty++;
+    return s;
+}
+
+// 从slab仓库取一个对象，调用者持有cache->lock
+static void *slab_get(struct kmem_cache *c) {
+    struct slab *s;
+
+    if (!list_empty(&c->partial)) {
+        s = list_first_entry(&c->partial, struct slab, link);
+    } else if (!list_empty(&c->empty)) {
+        s = list_first_entry(&c->empty, struct slab, link);
+    } else if ((s = slab_grow(c)) == NULL) {
+        return NULL;
+    }
+
+    if (s->inuse == 0) {
+        c->nr_empty--;
+    }
+    void *obj = s->freelist;
+    s->freelist = *(void **)obj;
+    s->inuse++;
+    c->slab_inuse++;
+
+    list_del(&s->link);
+    list_add(s->inuse == s->total ? &c->full : &c->partial, &s->link);
+    return obj;
+}
+
+// 把对象还给所属slab，调用者持有cache->lock
+static void slab_put(struct kmem_cache *c, void *obj) {
+    struct slab *s = obj_to_slab(obj);
+
+    *(void **)obj = s->freelist;
+    s->freelist = obj;
+    s->inuse--;
+    c->slab_inuse--;
+
+    list_del(&s->link);
+    if (s->inuse != 0) {
+        list_add(&c->partial, &s->link);
+    } else if (c->nr_empty < KMEM_EMPTY_KEEP) {
+        list_add(&c->empty, &s->link);
+        c->nr_empty++;
+    } else {
+        c->nr_slabs--;
+        free_page(s);
+    }
+}
+
+// magazine已空：从仓库补充到半满
+static void kmem_refill(struct kmem_cache *c, struct kmem_magazine *mag) {
+    spin_lock(&c->lock);
+    while (mag->count < (KMEM_MAG_SIZE + 1) / 2) {
+        void *obj = slab_get(c);
+        if (obj == NULL) {
+            break;
+        }
+        mag->objs[mag->count++] = obj;
+    }
+    c->nr_refill++;
+    spin_unlock(&c->lock);
+}
+
+// magazine已满：把一半对象还给仓库
+static void kmem_flush(struct kmem_cache *c, struct kmem_magazine *mag) {
+    spin_lock(&c->lock);
+    while (mag->count > KMEM_MAG_SIZE / 2) {
+        slab_put(c, mag->objs[--mag->count]);
+    }
+    c->nr_flush++;
+    spin_unlock(&c->lock);
+}
+
+void *kmem_cache_alloc(struct kmem_cache *c) {
+    void *obj = NULL;
+    uint64_t flags = local_irq_save();
+    struct kmem_magazine *mag = &c->mag[cpuid()];
+
+    if (mag->count == 0) {
+        kmem_refill(c, mag);
+    }
+    if (mag->count != 0) {
+        obj = mag->objs[--mag->count];
+    }
+    local_irq_restore(flags);
+    return obj;
+}
+
+void kmem_cache_free(struct kmem_cache *c, void *obj) {
+    if (obj == NULL) {
+        return;
+    }
+
+    uint64_t flags = local_irq_save();
+    struct kmem_magazine *mag = &c->mag[cpuid()];
+
+    if (mag->count == KMEM_MAG_SIZE) {
+        kmem_flush(c, mag);
+    }
+    mag->objs[mag->count++] = obj;
+    local_irq_restore(flags);
+}
+
+void kmalloc_init(void) {
+    for (int i = 0; i < KMALLOC_NR_CLASSES; i++) {
+        kmalloc_caches[i] = kmem_cache_create(kmalloc_names[i], KMEM_MIN_SIZE << i);
+    }
+}
+
+void *kmalloc(size_t size) {
+    if (size == 0) {
+        return NULL;
+    }
+
+    if (size > KMALLOC_MAX_SIZE) {
+        int order = 0;
+        while ((PAGE_SIZE << order) < size) {
+            order++;
+        }
+        return alloc_pages(order);
+    }
+
+    int idx = 0;
+    while ((size_t)(KMEM_MIN_SIZE << idx) < size) {
+        idx++;
+    }
+    return kmem_cache_alloc(kmalloc_caches[idx]);
+}
+
+void *kzalloc(size_t size) {
+    void *p = kmalloc(size);
+    if (p != NULL) {
+        memset(p, 0, size);
+    }
+    return p;
+}
+
+void kfree(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    // slab对象不会位于页首，页对齐的指针一定来自整页分配
+    if (((uint64_t)ptr & (PAGE_SIZE - 1)) == 0) {
+        int order = pmm_block_order(ptr);
+        if (order >= 0) {
+            free_pages(ptr, order);
+        }
+        return;
+    }
+
+    struct slab *s = obj_to_slab(ptr);
+    kmem_cache_free(s->cache, ptr);
+}
+
+void kmem_dump(void) {
+    puts("=== slab缓存统计 ===\n");
+    puts("名称 / 对象大小 / slab数 / 使用中 / magazine缓存 / 碎片率%\n");
+
+    for (int i = 0; i < nr_caches; i++) {
+        struct kmem_cache *c = &cache_pool[i];
+
+        spin_lock(&c->lock);
+        uint64_t cached = 0;
+        for (int j = 0; j < NCPU; j++) {
+            cached += c->mag[j].count;
+        }
+        uint64_t inuse = c->slab_inuse - cached;
+        uint64_t slabs = c->nr_slabs;
+        spin_unlock(&c->lock);
+
+        // 碎片率：slab占用的字节中没有交给调用者的比例
+        uint64_t frag = 0;
+        if (slabs != 0) {
+            uint64_t total = slabs * PAGE_SIZE;
+            frag = (total - inuse * c->obj_size) * 100 / total;
+        }
+
+        puts(c->name);
+        puts(" / ");
+        print_dec(c->obj_size);
+        puts(" / ");
+        print_dec(slabs);
+        puts(" / ");
+        print_dec(inuse);
+        puts(" / ");
+        print_dec(cached);
+        puts(" / ");
+        print_dec(frag);
+        puts("\n");
+    }
+    puts("\n");
+}
@@ -0,0 +1,158 @@
+#include "kernel.h"
+#include "riscv.h"
+#include "sbi.h"
+#include "fdt.h"
+#include "pmm.h"
+#include "cpu.h"
+#include "smp.h"
+#include "trap.h"
+#include "sched.h"
+
+struct cpu cpus[NCPU];
+int nr_cpus = 1;
+
+_Static_assert(offsetof(struct cpu, id) == 0, "boot.S: CPU_ID");
+_Static_assert(offsetof(struct cpu, stack_top) == 24, "boot.S: CPU_STACK_TOP");
+
+// 等待从核上线的最长时间（time计数）
+#define SMP_START_TIMEOUT   10000000UL
+
+int hartid_to_cpu(uint64_t hartid) {
+    for (int i = 0; i < nr_cpus; i++) {
+        if (cpus[i].hartid == hartid) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+uint64_t cpumask_next_harts(uint32_t *cpumask, uint64_t *base) {
+    uint64_t lo = UINT64_MAX;
+    uint64_t mask = 0;
+
+    for (int c = 0; c < nr_cpus; c++) {
+        if ((*cpumask & (1U << c)) && cpus[c].hartid < lo) {
+            lo = cpus[c].hartid;
+        }
+    }
+    for (int c = 0; c < nr_cpus; c++) {
+        if ((*cpumask & (1U << c)) && cpus[c].hartid - lo < 64) {
+            mask |= 1UL << (cpus[c].hartid - lo);
+            *cpumask &= ~(1U << c);
+        }
+    }
+    // 不在线的cpu不会被选中，直接丢弃
+    *cpumask &= (1U << nr_cpus) - 1;
+    *base = lo;
+    return mask;
+}
+
+// 从核C入口：a0 = hartid, a1 = 本hart的struct cpu，栈和tp已由boot.S设置
+void secondary_main(uint64_t hartid, struct cpu *c) {
+    (void)hartid;
+
+    // 与启动hart的超时判定竞争：启动hart已经放弃这个槽位时不能再上线，
+    // 它不在nr_cpus之内，任何全局数据都不会把它当作在线cpu
+    int expected = CPU_STARTING;
+    if (!__atomic_compare_exchange_n(&c->started, &expected, CPU_ONLINE, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        for (;;) {
+            asm volatile("wfi");
+        }
+    }
+
+    trap_init_hart();
+
+    // 调度循环空闲时会顺带把日志输出到控制台
+    sched_run();
+}
+
+static int hart_is_usable(int node) {
+    const char *type = fdt_getprop(node, "device_type", NULL);
+    const char *status = fdt_getprop(node, "status", NULL);
+
+    if (type == NULL || strcmp(type, "cpu") != 0) {
+        return 0;
+    }
+    return status == NULL || strcmp(status, "okay") == 0 || strcmp(status, "ok") == 0;
+}
+
+void smp_init(uint64_t boot_hartid) {
+    extern char secondary_entry[];
+
+    puts("=== 启动从核 ===\n");
+
+    cpus[0].id = 0;
+    cpus[0].hartid = boot_hartid;
+    cpus[0].started = CPU_ONLINE;
+
+    int cpus_node = fdt_find_node("/cpus");
+    if (cpus_node < 0) {
+        puts("警告: 设备树中没有/cpus节点，仅使用启动hart\n\n");
+        return;
+    }
+
+    // 按设备树顺序逐个启动，启动hart固定为0。只有确认上线的hart才计入nr_cpus，
+    // cpus[0..nr_cpus)始终紧凑且全部在线，遍历nr_cpus的代码不会等待不存在的hart
+    for (int n = fdt_node(cpus_node)->first_child; n >= 0; n = fdt_node(n)->next_sibling) {
+        uint64_t hartid;
+        if (!hart_is_usable(n) || fdt_get_reg(n, 0, &hartid, NULL) != 0 ||
+            hartid == boot_hartid) {
+            continue;
+        }
+        if (nr_cpus >= NCPU) {
+            puts("警告: hart数量超过NCPU，其余hart保持停止\n");
+            break;
+        }
+
+        // hart_start失败的hart从未运行，槽位和栈留给下一个hart
+        struct cpu *c = &cpus[nr_cpus];
+        if (c->stack_top == 0) {
+            void *stack = alloc_pages(KSTACK_ORDER);
+            if (stack == NULL) {
+                puts("错误: 无法分配从核栈\n");
+                break;
+            }
+            c->stack_top = (uint64_t)stack + (PAGE_SIZE << KSTACK_ORDER);
+        }
+        c->id = nr_cpus;
+        c->hartid = hartid;
+        c->started = CPU_STARTING;
+
+        // 从核以关闭MMU的状态进入secondary_entry，传入的地址都是物理地址；
+        // boot.S在跳到高地址后再把struct cpu的地址换回内核虚拟地址
+        asm volatile("fence w, w" ::: "memory");
+        struct sbiret ret = sbi_hart_start(c->hartid, __pa(secondary_entry), __pa(c));
+        if (ret.error != 0) {
+            puts("错误: hart_start失败 hart=");
+            print_dec(c->hartid);
+            puts("\n");
+            continue;
+        }
+
+        uint64_t start = csr_read(time);
+        while (c->started == CPU_STARTING && csr_read(time) - start < SMP_START_TIMEOUT) {
+        }
+        int expected = CPU_STARTING;
+        if (__atomic_compare_exchange_n(&c->started, &expected, CPU_ABANDONED, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            // 超时的hart之后仍可能读取这个槽位的栈和编号，槽位不能复用，
+            // 其余hart也就不再启动
+            puts("hart ");
+            print_dec(c->hartid);
+            puts(" 启动超时，其余hart保持停止\n");
+            break;
+        }
+
+        puts("hart ");
+        print_dec(c->hartid);
+        puts(" -> cpu");
+        print_dec(c->id);
+        puts(" 已上线\n");
+        nr_cpus++;
+    }
+
+    puts("在线hart数: ");
+    print_dec(nr_cpus);
+    puts("\n✓ 从核启动完成\n\n");
+}
@@ -0,0 +1,63 @@
+#include "kernel.h"
+#include "riscv.h"
+#include "cpu.h"
+#include "spinlock.h"
+
+void spin_lock_init(struct spinlock *lk, const char *name) {
+    ticket_lock_init(&lk->lock, name);
+    lk->cpu = -1;
+}
+
+void spin_lock(struct spinlock *lk) {
+    push_off();
+    if (ticket_is_locked(&lk->lock) && lk->cpu == cpuid()) {
+        puts("错误: 重复获取自旋锁 ");
+        puts(lk->lock.stat.name);
+        puts("\n");
+        panic("spin_lock");
+    }
+
+    ticket_acquire(&lk->lock);
+    lk->cpu = cpuid();
+}
+
+int spin_trylock(struct spinlock *lk) {
+    push_off();
+    if (!ticket_tryacquire(&lk->lock)) {
+        pop_off();
+        return 0;
+    }
+    lk->cpu = cpuid();
+    return 1;
+}
+
+void spin_unlock(struct spinlock *lk) {
+    lk->cpu = -1;
+    ticket_release(&lk->lock);
+    pop_off();
+}
+
+void push_off(void) {
+    uint64_t flags = local_irq_save();
+    struct cpu *c = mycpu();
+
+    if (c->noff == 0) {
+        c->intena = flags != 0;
+    }
+    c->noff++;
+}
+
+void pop_off(void) {
+    struct cpu *c = mycpu();
+
+    if (csr_read(sstatus) & SSTATUS_SIE) {
+        panic("pop_off时中断已打开");
+    }
+    if (c->noff < 1) {
+        panic("pop_off不匹配");
+    }
+    c->noff--;
+    if (c->noff == 0 && c->intena) {
+        local_irq_restore(1);
+    }
+}
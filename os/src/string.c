@@ -0,0 +1,68 @@
+#include "kernel.h"
+
+// 字符串和内存操作（-fno-builtin下编译器仍可能生成memset/memcpy调用）
+
+int strlen(const char *s) {
+    int len = 0;
+    while (*s++) len++;
+    return len;
+}
+
+int strcmp(const char *s1, const char *s2) {
+    while (*s1 && (*s1 == *s2)) {
+        s1++;
+        s2++;
+    }
+    return *(unsigned char *)s1 - *(unsigned char *)s2;
+}
+
+int strncmp(const char *s1, const char *s2, size_t n) {
+    while (n && *s1 && (*s1 == *s2)) {
+        s1++;
+        s2++;
+        n--;
+    }
+    if (n == 0) {
+        return 0;
+    }
+    return *(unsigned char *)s1 - *(unsigned char *)s2;
+}
+
+void *memset(void *dst, int c, size_t n) {
+    unsigned char *d = dst;
+
+    // 对齐部分按8字节写入
+    if (((uint64_t)d & 7) == 0) {
+        uint64_t v = (unsigned char)c;
+        v |= v << 8;
+        v |= v << 16;
+        v |= v << 32;
+        while (n >= 8) {
+            *(uint64_t *)d = v;
+            d += 8;
+            n -= 8;
+        }
+    }
+    while (n--) {
+        *d++ = (unsigned char)c;
+    }
+    return dst;
+}
+
+void *memcpy(void *dst, const void *src, size_t n) {
+    unsigned char *d = dst;
+    const unsigned char *s = src;
+
+    if ((((uint64_t)d | (uint64_t)s) & 7) == 0) {
+        while (n >= 8) {
+            *(uint64_t *)d = *(const uint64_t *)s;
+            d += 8;
+            s += 8;
+            n -= 8;
+        }
+    }
+    while (n--) {
+        *d++ = *s++;
+    }
+    return dst;
+}
@@ -0,0 +1,470 @@
+#include "kernel.h"
+#include "riscv.h"
+#include "sbi.h"
+#include "cpu.h"
+#include "fdt.h"
+#include "spinlock.h"
+#include "printk.h"
+#include "timer.h"
+#include "sched.h"
+
+// 时间轮采用经典的级联方式：
+// 第L级的槽按到期单位的第6L~6L+5位索引，距离当前时间越远放得越高；
+// 每当第0级转完一圈，把第1级当前槽中的定时器重新插入（自然落到更低的级），依此类推。
+// 第0级每个槽只对应一个到期单位，因此其中的定时器到槽即到期。
+// 长时间没有事件时，推进时直接跳到下一个有内容的槽或级联点，不逐单位空转。
+
+#define TW_SLOT_MASK    (TW_SLOTS - 1)
+#define TW_LEVEL_SHIFT(l)   ((l) * TW_SLOT_BITS)
+#define TW_MAX_DELTA    (1UL << (TW_LEVELS * TW_SLOT_BITS))
+
+struct timer_wheel {
+    struct spinlock lock;
+    uint64_t clk;                   // 下一个待处理的时间单位
+    uint64_t pending[TW_LEVELS];    // 非空槽位图
+    uint64_t deadline;              // 已写入硬件的截止时间（tick）
+    uint64_t nr_timers;
+    uint64_t nr_irqs;
+    uint64_t nr_fired;
+    struct list_head slots[TW_LEVELS][TW_SLOTS];
+} __attribute__((aligned(64)));
+
+uint64_t timebase_freq = 10000000;  // QEMU virt默认值，timer_init后以设备树为准
+static uint64_t timebase_recip = UINT64_MAX / 10000000;    // 随timebase_freq更新
+static int unit_shift;              // 一个时间单位 = 2^unit_shift个tick
+static int use_sstc;                // 所有hart都支持Sstc时直接写stimecmp
+static struct timer_wheel wheels[NCPU];
+
+// 没有Zbb扩展，用de Bruijn序列求最低置位（避免依赖libgcc）
+static inline int ctz64(uint64_t x) {
+    static const uint8_t table[64] = {
+        0,  1,  2, 53,  3,  7, 54, 27,  4, 38, 41,  8, 34, 55, 48, 28,
+        62,  5, 39, 46, 44, 42, 22,  9, 24, 35, 59, 56, 49, 18, 29, 11,
+        63, 52,  6, 26, 37, 40, 33, 47, 61, 45, 43, 21, 23, 58, 17, 10,
+        51, 25, 36, 32, 60, 20, 57, 16, 50, 31, 19, 15, 30, 14, 13, 12,
+    };
+    return table[((x & -x) * 0x022fdd63cc95386dULL) >> 58];
+}
+
+// 位图中从pos开始（循环）第一个置位相对pos的距离，调用者保证bitmap非0
+static inline uint64_t next_slot(uint64_t bitmap, int pos) {
+    uint64_t rot = (bitmap >> pos) | (pos ? bitmap << (64 - pos) : 0);
+    return ctz64(rot);
+}
+
+static inline uint64_t ticks_to_unit(uint64_t ticks) {
+    return (ticks + (1UL << unit_shift) - 1) >> unit_shift;
+}
+
+static void wheel_enqueue(struct timer_wheel *w, struct timer *t) {
+    uint64_t u = t->unit < w->clk ? w->clk : t->unit;
+    uint64_t delta = u - w->clk;
+    int level = 0;
+
+    if (delta >= TW_MAX_DELTA) {
+        // 超出时间轮范围：先放在最高级最远的槽，级联时会按真实到期时间重新安排
+        u = w->clk + TW_MAX_DELTA - 1;
+        level = TW_LEVELS - 1;
+    } else {
+        while (delta >= (1UL << TW_LEVEL_SHIFT(level + 1))) {
+            level++;
+        }
+    }
+
+    int slot = (u >> TW_LEVEL_SHIFT(level)) & TW_SLOT_MASK;
+    list_add_tail(&w->slots[level][slot], &t->entry);
+    w->pending[level] |= 1UL << slot;
+    t->wheel = w;
+    t->level = level;
+    t->slot = slot;
+}
+
+static void wheel_dequeue(struct timer_wheel *w, struct timer *t) {
+    list_del(&t->entry);
+    if (list_empty(&w->slots[t->level][t->slot])) {
+        w->pending[t->level] &= ~(1UL << t->slot);
+    }
+    t->wheel = NULL;
+}
+
+// 把第level级slot槽中的定时器重新插入，落到更低的级
+static void wheel_cascade(struct timer_wheel *w, int level, int slot) {
+    struct list_head *head = &w->slots[level][slot];
+    struct list_head tmp;
+
+    if (list_empty(head)) {
+        return;
+    }
+    // 先整体摘到临时链表，避免重新插入到同一槽时死循环
+    tmp.next = head->next;
+    tmp.prev = head->prev;
+    tmp.next->prev = &tmp;
+    tmp.prev->next = &tmp;
+    list_init(head);
+    w->pending[level] &= ~(1UL << slot);
+
+    while (!list_empty(&tmp)) {
+        struct timer *t = list_first_entry(&tmp, struct timer, entry);
+        list_del(&t->entry);
+        wheel_enqueue(w, t);
+    }
+}
+
+// 下一个需要处理的时间单位：第0级非空槽的到期点或高级槽的级联点
+static uint64_t wheel_next_event(struct timer_wheel *w) {
+    uint64_t next = UINT64_MAX;
+
+    for (int l = 0; l < TW_LEVELS; l++) {
+        if (w->pending[l] == 0) {
+            continue;
+        }
+        int shift = TW_LEVEL_SHIFT(l);
+        uint64_t base = (w->clk + (1UL << shift) - 1) >> shift;
+        uint64_t due = (base + next_slot(w->pending[l], base & TW_SLOT_MASK)) << shift;
+        if (due < next) {
+            next = due;
+        }
+    }
+    return next;
+}
+
+// 最早的实际到期时间（单位）：第0级的槽即到期点，高级只需查看最先级联的那个槽
+static uint64_t wheel_next_expiry(struct timer_wheel *w) {
+    uint64_t next = UINT64_MAX;
+
+    for (int l = 0; l < TW_LEVELS; l++) {
+        if (w->pending[l] == 0) {
+            continue;
+        }
+        int shift = TW_LEVEL_SHIFT(l);
+        uint64_t base = (w->clk + (1UL << shift) - 1) >> shift;
+        int slot = (base + next_slot(w->pending[l], base & TW_SLOT_MASK)) & TW_SLOT_MASK;
+
+        struct list_head *pos;
+        list_for_each(pos, &w->slots[l][slot]) {
+            struct timer *t = list_entry(pos, struct timer, entry);
+            uint64_t u = t->unit < w->clk ? w->clk : t->unit;
+            if (u < next) {
+                next = u;
+            }
+        }
+    }
+    return next;
+}
+
+// 推进到now（含），到期的定时器移入expired，调用者持有w->lock
+static void wheel_advance(struct timer_wheel *w, uint64_t now, struct list_head *expired) {
+    while (w->clk <= now) {
+        uint64_t clk = w->clk;
+
+        if ((clk & TW_SLOT_MASK) == 0) {
+            for (int l = 1; l < TW_LEVELS; l++) {
+                int slot = (clk >> TW_LEVEL_SHIFT(l)) & TW_SLOT_MASK;
+                wheel_cascade(w, l, slot);
+                if (slot != 0) {
+                    break;
+                }
+            }
+        }
+
+        struct list_head *head = &w->slots[0][clk & TW_SLOT_MASK];
+        while (!list_empty(head)) {
+            struct timer *t = list_first_entry(head, struct timer, entry);
+            wheel_dequeue(w, t);
+            list_add_tail(expired, &t->entry);
+            w->nr_timers--;
+        }
+
+        w->clk = clk + 1;
+        uint64_t next = wheel_next_event(w);
+        if (next > now + 1) {
+            next = now + 1;
+        }
+        if (next > w->clk) {
+            w->clk = next;
+        }
+    }
+}
+
+static inline void stimecmp_write(uint64_t ticks) {
+    // 用编号而不是stimecmp这个名字，旧版汇编器不认识它
+    csr_write(CSR_STIMECMP, ticks);
+}
+
+// 设置本hart的下一次时钟中断：Sstc直接写CSR，否则经SBI TIME扩展陷入固件
+static void timer_set_deadline(uint64_t ticks) {
+    if (use_sstc) {
+        stimecmp_write(ticks);
+    } else {
+        sbi_set_timer(ticks);
+    }
+}
+
+// riscv,isa形如"rv64imafdch_zicsr_sstc"：单字母扩展之后是以'_'分隔的多字母扩展
+static int isa_string_has(const char *isa, const char *ext) {
+    const char *p = isa;
+
+    while (*p && *p != '_') {
+        p++;
+    }
+    while (*p == '_') {
+        p++;
+        const char *e = ext;
+        while (*e && (*p | 0x20) == *e) {
+            p++;
+            e++;
+        }
+        if (*e == '\0' && (*p == '_' || *p == '\0')) {
+            return 1;
+        }
+        while (*p && *p != '_') {
+            p++;
+        }
+    }
+    return 0;
+}
+
+static int cpu_has_ext(int node, const char *ext) {
+    const char *isa;
+
+    if (fdt_prop_has_string(node, "riscv,isa-extensions", ext)) {
+        return 1;
+    }
+    isa = fdt_getprop(node, "riscv,isa", NULL);
+    return isa != NULL && isa_string_has(isa, ext);
+}
+
+// 所有cpu节点都声明了Sstc才使用（OpenSBI据此打开menvcfg.STCE）
+static int detect_sstc(int cpus_node) {
+    const struct fdt_node *cpus = fdt_node(cpus_node);
+    int found = 0;
+
+    if (cpus == NULL) {
+        return 0;
+    }
+    for (int n = cpus->first_child; n >= 0; n = fdt_node(n)->next_sibling) {
+        const char *type = fdt_getprop(n, "device_type", NULL);
+        if (type == NULL || strcmp(type, "cpu") != 0) {
+            continue;
+        }
+        if (!cpu_has_ext(n, "sstc")) {
+            return 0;
+        }
+        found = 1;
+    }
+    return found;
+}
+
+#define REARM_ROUNDS    64
+
+// 测量一次重设截止时间的平均耗时（ns），测量期间截止时间保持在无穷远
+static uint64_t measure_rearm(int sstc) {
+    uint64_t start = rdtime();
+
+    for (int i = 0; i < REARM_ROUNDS; i++) {
+        if (sstc) {
+            stimecmp_write(UINT64_MAX);
+        } else {
+            sbi_set_timer(UINT64_MAX);
+        }
+    }
+    uint64_t ticks = rdtime() - start;
+    return ticks * 1000000000UL / timebase_freq / REARM_ROUNDS;
+}
+
+// 按最早到期时间重设硬件，调用者持有w->lock且w属于当前hart
+// 中断到来后必须重新写入（force），否则已过期的截止时间会让中断一直挂起
+static void wheel_reprogram(struct timer_wheel *w, int force) {
+    uint64_t next = wheel_next_expiry(w);
+    uint64_t deadline = next == UINT64_MAX ? UINT64_MAX : next << unit_shift;
+
+    if (force || deadline != w->deadline) {
+        w->deadline = deadline;
+        timer_set_deadline(deadline);
+    }
+}
+
+void timer_init(void) {
+    uint32_t freq;
+    int cpus_node = fdt_find_node("/cpus");
+
+    if (cpus_node >= 0 && fdt_getprop_u32(cpus_node, "timebase-frequency", &freq) == 0 && freq != 0) {
+        timebase_freq = freq;
+        timebase_recip = UINT64_MAX / freq;
+    }
+
+    // 时间单位取不超过1ms的最大2的幂个tick
+    unit_shift = 0;
+    while ((2UL << unit_shift) <= timebase_freq / 1000) {
+        unit_shift++;
+    }
+
+    for (int i = 0; i < NCPU; i++) {
+        struct timer_wheel *w = &wheels[i];
+        spin_lock_init(&w->lock, "timer_wheel");
+        w->deadline = UINT64_MAX;
+        for (int l = 0; l < TW_LEVELS; l++) {
+            for (int s = 0; s < TW_SLOTS; s++) {
+                list_init(&w->slots[l][s]);
+            }
+        }
+    }
+
+    printk(LOG_INFO, "定时器: timebase %lu Hz, 时间单位 %lu tick (%lu us)\n",
+           timebase_freq, 1UL << unit_shift, (1000000UL << unit_shift) / timebase_freq);
+
+    use_sstc = detect_sstc(cpus_node);
+    uint64_t sbi_ns = measure_rearm(0);
+    if (use_sstc) {
+        uint64_t sstc_ns = measure_rearm(1);
+        printk(LOG_INFO, "定时器: 使用Sstc stimecmp，重设延迟 %lu ns (SBI TIME %lu ns)\n",
+               sstc_ns, sbi_ns);
+    } else {
+        printk(LOG_INFO, "定时器: 未检测到Sstc，使用SBI TIME，重设延迟 %lu ns\n", sbi_ns);
+    }
+}
+
+void timer_setup(struct timer *t, timer_fn_t fn, void *data) {
+    list_init(&t->entry);
+    t->fn = fn;
+    t->data = data;
+    t->wheel = NULL;
+}
+
+void timer_add(struct timer *t, uint64_t expires) {
+    timer_cancel(t);
+
+    struct timer_wheel *w = &wheels[cpuid()];
+    spin_lock(&w->lock);
+    // 空闲的时间轮可能很久没推进，直接对齐到当前时间
+    if (w->nr_timers == 0) {
+        w->clk = rdtime() >> unit_shift;
+    }
+    t->expires = expires;
+    t->unit = ticks_to_unit(expires);
+    wheel_enqueue(w, t);
+    w->nr_timers++;
+    if ((t->unit << unit_shift) < w->deadline) {
+        wheel_reprogram(w, 0);
+    }
+    spin_unlock(&w->lock);
+}
+
+int timer_cancel(struct timer *t) {
+    struct timer_wheel *w = t->wheel;
+
+    if (w == NULL) {
+        return 0;
+    }
+    spin_lock(&w->lock);
+    // 加锁前可能已经到期被摘下
+    if (t->wheel != w) {
+        spin_unlock(&w->lock);
+        return 0;
+    }
+    wheel_dequeue(w, t);
+    w->nr_timers--;
+    spin_unlock(&w->lock);
+    // 不必重设硬件：提前到来的中断只会推进时间轮并重新设置
+    return 1;
+}
+
+void timer_interrupt(void) {
+    struct timer_wheel *w = &wheels[cpuid()];
+    struct list_head expired;
+
+    list_init(&expired);
+
+    spin_lock(&w->lock);
+    w->nr_irqs++;
+    wheel_advance(w, rdtime() >> unit_shift, &expired);
+    spin_unlock(&w->lock);
+
+    // 回调在锁外执行，可以重新挂入定时器
+    while (!list_empty(&expired)) {
+        struct timer *t = list_first_entry(&expired, struct timer, entry);
+        list_del(&t->entry);
+        w->nr_fired++;
+        t->fn(t);
+    }
+
+    spin_lock(&w->lock);
+    wheel_reprogram(w, 1);
+    spin_unlock(&w->lock);
+}
+
+// v / timebase_freq：乘倒数得到的商最多小1，用余数校正一次
+static inline uint64_t div_timebase(uint64_t v, uint64_t *rem) {
+    uint64_t q = mulhu(v, timebase_recip);
+    uint64_t r = v - q * timebase_freq;
+
+    if (r >= timebase_freq) {
+        q++;
+        r -= timebase_freq;
+    }
+    *rem = r;
+    return q;
+}
+
+void ticks_to_sec_us(uint64_t ticks, uint64_t *sec, uint64_t *usec) {
+    uint64_t rem;
+
+    *sec = div_timebase(ticks, &rem);
+    *usec = div_timebase(rem * 1000000, &rem);
+}
+
+uint64_t us_to_ticks(uint64_t us) {
+    return us * timebase_freq / 1000000;
+}
+
+uint64_t ms_to_ticks(uint64_t ms) {
+    return ms * timebase_freq / 1000;
+}
+
+static void sleep_wakeup(struct timer *t) {
+    *(volatile int *)t->data = 1;
+}
+
+// 不能在中断处理函数中调用。
+// 在线程中调用时让出CPU；否则本hart关中断检查完成标志后再wfi：
+// 中断挂起时wfi会立即返回，开中断后随即进入处理，不会丢失唤醒
+static void sleep_ticks(uint64_t ticks) {
+    volatile int done = 0;
+    struct timer t;
+
+    if (sched_current() != NULL) {
+        thread_sleep(ticks);
+        return;
+    }
+
+    timer_setup(&t, sleep_wakeup, (void *)&done);
+    timer_add(&t, rdtime() + ticks);
+
+    uint64_t flags = local_irq_save();
+    while (!done) {
+        asm volatile("wfi");
+        csr_set(sstatus, SSTATUS_SIE);
+        csr_clear(sstatus, SSTATUS_SIE);
+    }
+    local_irq_restore(flags);
+}
+
+void usleep(uint64_t us) {
+    sleep_ticks(us_to_ticks(us));
+}
+
+void msleep(uint64_t ms) {
+    sleep_ticks(ms_to_ticks(ms));
+}
+
+void udelay(uint64_t us) {
+    uint64_t ticks = us_to_ticks(us);
+
+    if (ticks >= (1UL << unit_shift)) {
+        sleep_ticks(ticks);
+        return;
+    }
+    uint64_t end = rdtime() + ticks;
+    while (rdtime() < end) {
+    }
+}
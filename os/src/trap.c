@@ -0,0 +1,117 @@
+#include "kernel.h"
+#include "riscv.h"
+#include "cpu.h"
+#include "pmm.h"
+#include "plic.h"
+#include "printk.h"
+#include "timer.h"
+#include "ipi.h"
+#include "trap.h"
+
+extern void trap_vector(void);
+
+static exception_handler_t exc_handlers[EXC_MAX];
+
+static const char *exc_names[EXC_MAX] = {
+    [EXC_INST_MISALIGNED]   = "指令地址未对齐",
+    [EXC_INST_ACCESS]       = "取指访问错误",
+    [EXC_ILLEGAL_INST]      = "非法指令",
+    [EXC_BREAKPOINT]        = "断点",
+    [EXC_LOAD_MISALIGNED]   = "读地址未对齐",
+    [EXC_LOAD_ACCESS]       = "读访问错误",
+    [EXC_STORE_MISALIGNED]  = "写地址未对齐",
+    [EXC_STORE_ACCESS]      = "写访问错误",
+    [EXC_ECALL_U]           = "U模式ecall",
+    [EXC_ECALL_S]           = "S模式ecall",
+    [EXC_INST_PAGE_FAULT]   = "取指缺页",
+    [EXC_LOAD_PAGE_FAULT]   = "读缺页",
+    [EXC_STORE_PAGE_FAULT]  = "写缺页",
+};
+
+void trap_set_handler(int cause, exception_handler_t handler) {
+    if (cause >= 0 && cause < EXC_MAX) {
+        exc_handlers[cause] = handler;
+    }
+}
+
+static void trap_dump(struct trap_frame *tf) {
+    uint64_t cause = tf->scause & ~SCAUSE_INTERRUPT;
+    const char *name = NULL;
+
+    if (!(tf->scause & SCAUSE_INTERRUPT) && cause < EXC_MAX) {
+        name = exc_names[cause];
+    }
+
+    printk(LOG_EMERG, "!!! 异常发生 !!! hart %lu: %s\n", mycpu()->hartid,
+           name ? name : ((tf->scause & SCAUSE_INTERRUPT) ? "未预期的中断" : "未知异常"));
+    printk(LOG_EMERG, "scause=0x%016lx sepc=0x%016lx stval=0x%016lx\n",
+           tf->scause, tf->sepc, tf->stval);
+    printk(LOG_EMERG, "sstatus=0x%016lx ra=0x%016lx sp=0x%016lx\n",
+           tf->sstatus, tf->regs[1], tf->regs[2]);
+    if (name != NULL &&
+        (cause == EXC_INST_PAGE_FAULT || cause == EXC_LOAD_PAGE_FAULT || cause == EXC_STORE_PAGE_FAULT)) {
+        // 在当前satp的页表里遍历出错地址，看停在哪一级
+        struct pt_walk_info info;
+        uint64_t *root = __va((csr_read(satp) & ((1UL << 44) - 1)) << PAGE_SHIFT);
+        int ret = pt_translate(root, tf->stval, &info);
+        printk(LOG_EMERG, "页表遍历: %s level=%d pte=0x%016lx\n",
+               ret == 0 ? "已映射" : "无效", info.level, info.pte);
+    }
+    for (int i = 5; i < 32; i += 3) {
+        printk(LOG_EMERG, "x%-2d=0x%016lx x%-2d=0x%016lx x%-2d=0x%016lx\n",
+               i, tf->regs[i], i + 1, i + 1 < 32 ? tf->regs[i + 1] : 0,
+               i + 2, i + 2 < 32 ? tf->regs[i + 2] : 0);
+    }
+}
+
+// 同步异常（以及没有专门入口的中断）
+void trap_handler(struct trap_frame *tf) {
+    uint64_t cause = tf->scause;
+
+    if (!(cause & SCAUSE_INTERRUPT) && cause < EXC_MAX && exc_handlers[cause] != NULL) {
+        if (exc_handlers[cause](tf) == 0) {
+            return;
+        }
+    }
+
+    trap_dump(tf);
+
+    // 重放日志，便于查看异常发生前的经过
+    dmesg();
+    panic("未处理的异常，系统关机");
+}
+
+// S模式软件中断：核间中断，先清挂起位再排空本hart的跨hart调用队列
+void irq_soft_handler(void) {
+    csr_clear(sip, 1UL << IRQ_S_SOFT);
+    ipi_handle();
+}
+
+// S模式时钟中断：推进本hart的时间轮
+void irq_timer_handler(void) {
+    timer_interrupt();
+}
+
+void irq_external_handler(void) {
+    plic_handle_irq();
+}
+
+// 每个hart各自执行：分配陷入栈，设置向量模式的stvec并打开中断
+void trap_init_hart(void) {
+    struct cpu *c = mycpu();
+
+    if (c->trap_stack_top == 0) {
+        char *stack = alloc_pages(TRAP_STACK_ORDER);
+        if (stack == NULL) {
+            panic("陷入栈分配失败");
+        }
+        c->trap_stack_top = (uint64_t)stack + (PAGE_SIZE << TRAP_STACK_ORDER);
+    }
+
+    csr_write(sscratch, c->trap_stack_top);
+    csr_write(stvec, (uint64_t)trap_vector | STVEC_MODE_VECTORED);
+
+    // 启用中断
+    csr_set(sstatus, SSTATUS_SIE);
+    csr_set(sie, (1UL << IRQ_S_TIMER) | (1UL << IRQ_S_EXT) | (1UL << IRQ_S_SOFT));
+}
@@ -0,0 +1,220 @@
+#include "kernel.h"
+#include "riscv.h"
+#include "fdt.h"
+#include "plic.h"
+#include "spinlock.h"
+#include "uart.h"
+
+// ns16550寄存器
+#define UART_RBR        0x00    // Receive Buffer Register
+#define UART_THR        0x00    // Transmit Holding Register
+#define UART_IER        0x01    // Interrupt Enable Register
+#define UART_IIR        0x02    // Interrupt Identification Register
+#define UART_FCR        0x02    // FIFO Control Register
+#define UART_LCR        0x03    // Line Control Register
+#define UART_MCR        0x04    // Modem Control Register
+#define UART_LSR        0x05    // Line Status Register
+
+#define IER_RDI         0x01    // 接收数据中断
+#define IER_THRI        0x02    // 发送保持寄存器空中断
+#define LSR_DR          0x01
+#define LSR_THRE        0x20
+#define IIR_NO_INT      0x01
+#define IIR_ID_MASK     0x0e
+#define IIR_THRE        0x02
+#define IIR_RDA         0x04
+#define IIR_RLS         0x06
+#define IIR_TIMEOUT     0x0c
+
+#define UART_FIFO_SIZE  16
+
+#define UART_REG(off)   (*(volatile uint8_t *)(uart_base + (off)))
+
+static uint64_t uart_base;
+static int uart_irq;
+
+// 发送：多个生产者在tx_lock下写入，THRE中断在同一把锁下搬运到FIFO
+static char tx_ring[UART_TX_RING_SIZE];
+static uint32_t tx_head, tx_tail;
+static struct spinlock tx_lock = SPINLOCK_INIT("uart_tx");
+
+// 接收：中断处理函数是唯一生产者
+static char rx_ring[UART_RX_RING_SIZE];
+static volatile uint32_t rx_head, rx_tail;
+static struct spinlock rx_lock = SPINLOCK_INIT("uart_rx");
+
+static uint64_t tx_full_stalls;
+static uint64_t rx_dropped;
+
+// 把环形缓冲中的数据搬进FIFO，至多16字节；调用者持有tx_lock
+static void uart_tx_pump(void) {
+    if (!(UART_REG(UART_LSR) & LSR_THRE)) {
+        return;
+    }
+    for (int i = 0; i < UART_FIFO_SIZE && tx_tail != tx_head; i++) {
+        UART_REG(UART_THR) = tx_ring[tx_tail % UART_TX_RING_SIZE];
+        tx_tail++;
+    }
+
+    // 缓冲空了就关闭THRE中断，否则等FIFO空后再来
+    if (tx_tail == tx_head) {
+        UART_REG(UART_IER) = IER_RDI;
+    } else {
+        UART_REG(UART_IER) = IER_RDI | IER_THRI;
+    }
+}
+
+static void uart_rx_drain(void) {
+    while (UART_REG(UART_LSR) & LSR_DR) {
+        char c = UART_REG(UART_RBR);
+        if (rx_head - rx_tail < UART_RX_RING_SIZE) {
+            rx_ring[rx_head % UART_RX_RING_SIZE] = c;
+            asm volatile("fence w, w" ::: "memory");
+            rx_head++;
+        } else {
+            rx_dropped++;
+        }
+    }
+}
+
+static void uart_intr(int irq, void *arg) {
+    (void)irq;
+    (void)arg;
+
+    // 一次中断里把所有待处理的原因都处理完
+    for (;;) {
+        uint8_t iir = UART_REG(UART_IIR);
+        if (iir & IIR_NO_INT) {
+            break;
+        }
+        switch (iir & IIR_ID_MASK) {
+        case IIR_RDA:
+        case IIR_TIMEOUT:
+            uart_rx_drain();
+            break;
+        case IIR_THRE:
+            spin_lock(&tx_lock);
+            uart_tx_pump();
+            spin_unlock(&tx_lock);
+            break;
+        case IIR_RLS:
+            (void)UART_REG(UART_LSR);
+            break;
+        default:
+            return;
+        }
+    }
+}
+
+// 选取UART节点：优先/chosen的stdout-path，其次第一个ns16550a
+static int uart_find_node(void) {
+    const char *path = fdt_path_getprop("/chosen", "stdout-path", NULL);
+
+    if (path != NULL) {
+        char buf[64];
+        int i = 0;
+        // 去掉":115200n8"之类的选项
+        while (path[i] && path[i] != ':' && i < (int)sizeof(buf) - 1) {
+            buf[i] = path[i];
+            i++;
+        }
+        buf[i] = '\0';
+        int n = fdt_find_node(buf);
+        if (n >= 0 && fdt_prop_has_string(n, "compatible", "ns16550a")) {
+            return n;
+        }
+    }
+    return fdt_find_compatible(-1, "ns16550a");
+}
+
+int uart_init(void) {
+    int node = uart_find_node();
+    uint32_t irq;
+
+    if (node < 0 || fdt_get_reg(node, 0, &uart_base, NULL) != 0) {
+        return -1;
+    }
+    if (fdt_getprop_u32(node, "interrupts", &irq) != 0) {
+        return -1;
+    }
+    uart_irq = irq;
+    // 寄存器经线性映射访问
+    uart_base = (uint64_t)__va(uart_base);
+
+    // 固件已配置好波特率，这里只设置8N1、开启并清空FIFO
+    UART_REG(UART_IER) = 0;
+    UART_REG(UART_LCR) = 0x03;
+    UART_REG(UART_FCR) = 0x07;
+    UART_REG(UART_MCR) = 0x08;      // OUT2：允许中断输出
+
+    if (plic_register_irq(uart_irq, uart_intr, NULL) != 0) {
+        uart_base = 0;
+        return -1;
+    }
+    // 发送中断随日志量而来，分散到所有hart；rx_ring仍只有一个生产者，
+    // 因为同一中断源在完成之前不会被第二个hart认领
+    plic_set_affinity(uart_irq, PLIC_AFFINITY_ALL);
+    UART_REG(UART_IER) = IER_RDI;
+
+    puts("UART基址: ");
+    print_hex(uart_base);
+    puts(" IRQ: ");
+    print_dec(uart_irq);
+    puts("\n");
+    return 0;
+}
+
+void uart_write(const char *s, int len) {
+    spin_lock(&tx_lock);
+    while (len > 0) {
+        // 缓冲满时只能就地把数据推给线路，记录一次停顿
+        if (tx_head - tx_tail == UART_TX_RING_SIZE) {
+            tx_full_stalls++;
+            while (!(UART_REG(UART_LSR) & LSR_THRE)) {
+            }
+            uart_tx_pump();
+            continue;
+        }
+        tx_ring[tx_head % UART_TX_RING_SIZE] = *s++;
+        tx_head++;
+        len--;
+    }
+    // FIFO空闲时直接启动发送，其余交给THRE中断
+    uart_tx_pump();
+    spin_unlock(&tx_lock);
+}
+
+void uart_write_sync(const char *s, int len) {
+    while (len-- > 0) {
+        while (!(UART_REG(UART_LSR) & LSR_THRE)) {
+        }
+        UART_REG(UART_THR) = *s++;
+    }
+}
+
+void uart_drain(void) {
+    for (;;) {
+        spin_lock(&tx_lock);
+        uart_tx_pump();
+        int empty = tx_tail == tx_head;
+        spin_unlock(&tx_lock);
+        if (empty) {
+            break;
+        }
+    }
+    while (!(UART_REG(UART_LSR) & LSR_THRE)) {
+    }
+}
+
+int uart_getc(void) {
+    int c = -1;
+
+    spin_lock(&rx_lock);
+    if (rx_tail != rx_head) {
+        asm volatile("fence r, r" ::: "memory");
+        c = (uint8_t)rx_ring[rx_tail % UART_RX_RING_SIZE];
+        rx_tail++;
+    }
+    spin_unlock(&rx_lock);
+    return c;
+}
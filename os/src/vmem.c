@@ -0,0 +1,252 @@
+#include "kernel.h"
+#include "riscv.h"
+#include "sbi.h"
+#include "cpu.h"
+#include "pmm.h"
+#include "smp.h"
+#include "spinlock.h"
+#include "printk.h"
+#include "trap.h"
+#include "mm.h"
+#include "vmem.h"
+
+// 懒分配区的页只有读写权限，带G位在所有地址空间中共享
+#define LAZY_PTE    (PTE_R | PTE_W | PTE_A | PTE_D | PTE_G)
+
+struct vmem_region {
+    uint64_t start;
+    uint64_t end;
+    const char *name;
+    uint64_t resident;          // 已经分配了物理页的页数
+};
+
+// 按起始地址排序；区域表和懒分配区的页表都由vmem_lock保护
+static struct vmem_region regions[VMEM_MAX_REGIONS];
+static int nr_regions;
+static struct spinlock vmem_lock = SPINLOCK_INIT("vmem");
+static uint64_t *kernel_root;
+
+static uint64_t nr_faults;
+static uint64_t nr_fault_races;     // 别的hart已经补好映射，本hart只需刷新TLB
+static uint64_t nr_frees;
+
+static struct vmem_region *region_find(uint64_t va) {
+    for (int i = 0; i < nr_regions; i++) {
+        if (va >= regions[i].start && va < regions[i].end) {
+            return &regions[i];
+        }
+    }
+    return NULL;
+}
+
+// 给区域r中的va补上一个清零的物理页，调用者持有vmem_lock且va尚未映射
+static int vmem_map_page(struct vmem_region *r, uint64_t va) {
+    void *page = alloc_page();
+    if (page == NULL) {
+        return -1;
+    }
+    memset(page, 0, PAGE_SIZE);
+    if (map_range(kernel_root, va, __pa(page), PAGE_SIZE, LAZY_PTE) != 0) {
+        free_page(page);
+        return -1;
+    }
+    r->resident++;
+    return 0;
+}
+
+// 读/写缺页：stval是出错的虚拟地址
+// 缺页处理要依次获取vmem_lock和pmm的锁，持有其中任何一把锁时访问懒分配的页
+// 都会在同一hart上重复加锁，所以只有不在这些锁之下访问的数据才能懒分配
+static int vmem_fault(struct trap_frame *tf) {
+    uint64_t va = PAGE_ROUND_DOWN(tf->stval);
+    int ret = -1;
+
+    if (va < LAZY_VBASE || va >= LAZY_VBASE + LAZY_VSIZE) {
+        return -1;
+    }
+
+    spin_lock(&vmem_lock);
+    struct vmem_region *r = region_find(va);
+    if (r != NULL) {
+        uint64_t *pte = pt_walk(kernel_root, va, 0);
+        if (pte != NULL && (*pte & PTE_V)) {
+            // 缺页可能是本hart的TLB缓存了映射建立之前的无效项
+            nr_fault_races++;
+            ret = 0;
+        } else if (vmem_map_page(r, va) == 0) {
+            nr_faults++;
+            ret = 0;
+        }
+    }
+    spin_unlock(&vmem_lock);
+
+    if (ret == 0) {
+        asm volatile("sfence.vma %0, zero" : : "r"(va) : "memory");
+    }
+    return ret;
+}
+
+void vmem_init(void) {
+    kernel_root = init_mm.root;
+
+    // 预先建好这一段的L1页表，用户地址空间复制根页表后共享同一张L1，缺页补上的映射处处可见
+    uint64_t *l1 = pt_alloc();
+    if (l1 == NULL) {
+        panic("vmem: L1页表分配失败");
+    }
+    kernel_root[VPN(LAZY_VBASE, 2)] = PA_TO_PTE(__pa(l1)) | PTE_V;
+
+    trap_set_handler(EXC_LOAD_PAGE_FAULT, vmem_fault);
+    trap_set_handler(EXC_STORE_PAGE_FAULT, vmem_fault);
+
+    pr_info("vmem: 懒分配区 0x%lx - 0x%lx\n", LAZY_VBASE, LAZY_VBASE + LAZY_VSIZE);
+}
+
+void *vmem_alloc(uint64_t size, const char *name) {
+    size = PAGE_ROUND_UP(size);
+    if (size == 0 || size > LAZY_VSIZE) {
+        return NULL;
+    }
+
+    spin_lock(&vmem_lock);
+    if (nr_regions == VMEM_MAX_REGIONS) {
+        spin_unlock(&vmem_lock);
+        return NULL;
+    }
+
+    // 首次适配：新区域与前一个区域（或区首）之间、与后一个区域之间各留至少一个保护页
+    uint64_t prev_end = LAZY_VBASE;
+    int i;
+    for (i = 0; i <= nr_regions; i++) {
+        uint64_t next = i < nr_regions ? regions[i].start : LAZY_VBASE + LAZY_VSIZE;
+        if (next - prev_end >= size + 2 * PAGE_SIZE) {
+            break;
+        }
+        if (i < nr_regions) {
+            prev_end = regions[i].end;
+        }
+    }
+    if (i > nr_regions) {
+        spin_unlock(&vmem_lock);
+        return NULL;
+    }
+
+    for (int j = nr_regions; j > i; j--) {
+        regions[j] = regions[j - 1];
+    }
+    uint64_t start = prev_end + PAGE_SIZE;
+    regions[i] = (struct vmem_region){
+        .start = start,
+        .end = start + size,
+        .name = name,
+        .resident = 0,
+    };
+    nr_regions++;
+    spin_unlock(&vmem_lock);
+
+    return (void *)start;
+}
+
+int vmem_populate(void *addr, uint64_t size) {
+    uint64_t start = PAGE_ROUND_DOWN((uint64_t)addr);
+    uint64_t end = PAGE_ROUND_UP((uint64_t)addr + size);
+    int ret = 0;
+
+    spin_lock(&vmem_lock);
+    struct vmem_region *r = region_find(start);
+    if (r == NULL || end > r->end) {
+        panic("vmem: 预先分配的范围不在区域内");
+    }
+    for (uint64_t va = start; va < end && ret == 0; va += PAGE_SIZE) {
+        uint64_t *pte = pt_walk(kernel_root, va, 0);
+        if (pte == NULL || !(*pte & PTE_V)) {
+            ret = vmem_map_page(r, va);
+        }
+    }
+    spin_unlock(&vmem_lock);
+    // 只新增了映射，无效项不会被TLB缓存，不需要刷新
+    return ret;
+}
+
+// 所有hart的TLB中都可能缓存了这段G映射
+static void vmem_flush_tlb(uint64_t start, uint64_t end) {
+    int full = (end - start) / PAGE_SIZE > TLB_FLUSH_THRESHOLD;
+
+    smp_mb();
+    if (full) {
+        asm volatile("sfence.vma zero, zero" ::: "memory");
+    } else {
+        for (uint64_t va = start; va < end; va += PAGE_SIZE) {
+            asm volatile("sfence.vma %0, zero" : : "r"(va) : "memory");
+        }
+    }
+
+    uint32_t remote = ((1U << nr_cpus) - 1) & ~(1U << cpuid());
+    while (remote != 0) {
+        uint64_t base;
+        uint64_t harts = cpumask_next_harts(&remote, &base);
+        if (harts == 0) {
+            break;
+        }
+        sbi_remote_sfence_vma(harts, base, full ? 0 : start, full ? (uint64_t)-1 : end - start);
+    }
+    xlat_cache_invalidate();
+}
+
+// 持锁完成全部工作：在物理页归还之前，这段地址不能被重新分配出去
+void vmem_free(void *addr) {
+    spin_lock(&vmem_lock);
+
+    int i;
+    for (i = 0; i < nr_regions; i++) {
+        if (regions[i].start == (uint64_t)addr) {
+            break;
+        }
+    }
+    if (i == nr_regions) {
+        panic("vmem: 释放未登记的区域");
+    }
+    struct vmem_region r = regions[i];
+    for (int j = i; j < nr_regions - 1; j++) {
+        regions[j] = regions[j + 1];
+    }
+    nr_regions--;
+
+    if (r.resident > 0) {
+        // 先只清V位、保留PPN，刷新TLB之后再按PPN归还物理页
+        for (uint64_t va = r.start; va < r.end; va += PAGE_SIZE) {
+            uint64_t *pte = pt_walk(kernel_root, va, 0);
+            if (pte != NULL && (*pte & PTE_V)) {
+                *pte &= ~PTE_V;
+            }
+        }
+        vmem_flush_tlb(r.start, r.end);
+        for (uint64_t va = r.start; va < r.end; va += PAGE_SIZE) {
+            uint64_t *pte = pt_walk(kernel_root, va, 0);
+            if (pte != NULL && *pte != 0) {
+                free_page(__va(PTE_TO_PA(*pte)));
+                *pte = 0;
+            }
+        }
+    }
+    nr_frees++;
+    spin_unlock(&vmem_lock);
+}
+
+void vmem_dump(void) {
+    uint64_t reserved = 0, resident = 0;
+
+    spin_lock(&vmem_lock);
+    pr_info("=== 懒分配区 ===\n");
+    pr_info("区域 / 起始 / 预留KB / 驻留KB\n");
+    for (int i = 0; i < nr_regions; i++) {
+        struct vmem_region *r = &regions[i];
+        pr_info("%s / 0x%lx / %lu / %lu\n", r->name, r->start,
+                (r->end - r->start) / 1024, r->resident * PAGE_SIZE / 1024);
+        reserved += r->end - r->start;
+        resident += r->resident * PAGE_SIZE;
+    }
+    pr_info("合计: 预留 %lu KB, 驻留 %lu KB, 缺页 %lu (其中TLB补刷 %lu), 已释放区域 %lu\n",
+            reserved / 1024, resident / 1024, nr_faults, nr_fault_races, nr_frees);
+    spin_unlock(&vmem_lock);
+}
@@ -0,0 +1,159 @@
+// 构建时在宿主机上运行，生成内核的Sv39启动页表
+// 布局全部来自memlayout.h中的编译期常量，页表页依次排在BOOT_PT_BASE起的连续页中，
+// 中间级PTE直接写入下级页表的物理地址，启动时只需写satp。
+// 生成两张根页表，共用高地址部分的下级页表：
+//   boot_page_table      内核页表，低半部分全空
+//   boot_trampoline_pt   另加低4G恒等映射，boot.S在MMU打开、PC还是物理地址时短暂使用
+// 用法：gen_boot_pt > boot_pt.S
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "memlayout.h"
+#include "riscv.h"
+
+#define KERNEL_PTE  (PTE_R | PTE_W | PTE_X | PTE_A | PTE_D | PTE_G)
+#define DEVICE_PTE  (PTE_R | PTE_W | PTE_A | PTE_D | PTE_G)
+// 恒等映射不带G位：切回内核页表时随sfence.vma一起失效，不会残留在TLB里
+#define IDENT_PTE   (PTE_R | PTE_W | PTE_X | PTE_A | PTE_D)
+
+#define ROOT_KERNEL     0
+#define ROOT_TRAMPOLINE 1
+
+struct boot_map {
+    const char *name;
+    uint64_t va;
+    uint64_t pa;
+    uint64_t size;
+    uint64_t perm;
+};
+
+static const struct boot_map boot_maps[] = {
+    { "direct",   PAGE_OFFSET,  0,           DIRECT_MAP_SIZE,    KERNEL_PTE },
+    { "kernel",   KERNEL_VBASE, KERNEL_BASE, KERNEL_VMAP_SIZE,   KERNEL_PTE },
+    { "uart",     UART_VBASE,   UART_BASE,   PAGE_SIZE,          DEVICE_PTE },
+};
+
+static const struct boot_map ident_map = { "identity", 0, 0, DIRECT_MAP_SIZE, IDENT_PTE };
+
+static uint64_t tables[BOOT_PT_MAX_PAGES][512];
+static int nr_tables = 2;               // tables[0]、tables[1]是两张根页表
+static uint64_t leaf_count[3];
+
+static uint64_t table_pa(int idx) {
+    return BOOT_PT_BASE + (uint64_t)idx * PAGE_SIZE;
+}
+
+static int table_idx(uint64_t pte) {
+    return (int)((PTE_TO_PA(pte) - BOOT_PT_BASE) / PAGE_SIZE);
+}
+
+// 与kernel.c中的pt_walk_create相同，只是页表页从tables[]中顺序分配
+static uint64_t *walk_create(int root, uint64_t va, int level) {
+    uint64_t *table = tables[root];
+
+    for (int l = 2; l > level; l--) {
+        uint64_t *pte = &table[VPN(va, l)];
+        if (*pte & PTE_V) {
+            if (*pte & PTE_LEAF_MASK) {
+                return NULL;
+            }
+        } else {
+            if (nr_tables == BOOT_PT_MAX_PAGES) {
+                fprintf(stderr, "gen_boot_pt: BOOT_PT_MAX_PAGES (%d) too small\n", BOOT_PT_MAX_PAGES);
+                return NULL;
+            }
+            *pte = PA_TO_PTE(table_pa(nr_tables)) | PTE_V;
+            nr_tables++;
+        }
+        table = tables[table_idx(*pte)];
+    }
+    return &table[VPN(va, level)];
+}
+
+// 与kernel.c中的map_range相同：对齐且长度足够时优先用大页
+static int map(int root, const struct boot_map *m) {
+    uint64_t va = m->va, pa = m->pa, size = m->size;
+
+    if ((va | pa | size) & (PAGE_SIZE - 1)) {
+        return -1;
+    }
+    while (size > 0) {
+        int level = 2;
+        while (level > 0 &&
+               (((va | pa) & (LEVEL_SIZE(level) - 1)) || size < LEVEL_SIZE(level))) {
+            level--;
+        }
+
+        uint64_t *pte = walk_create(root, va, level);
+        if (pte == NULL || (*pte & PTE_V)) {
+            return -1;
+        }
+        *pte = PA_TO_PTE(pa) | m->perm | PTE_V;
+        leaf_count[level]++;
+
+        va += LEVEL_SIZE(level);
+        pa += LEVEL_SIZE(level);
+        size -= LEVEL_SIZE(level);
+    }
+    return 0;
+}
+
+// 连续的零项合并成一条.zero
+static void emit_table(int idx) {
+    printf("\n    # page %d @ 0x%llx\n", idx, (unsigned long long)table_pa(idx));
+    for (int i = 0; i < 512;) {
+        if (tables[idx][i] == 0) {
+            int j = i;
+            while (j < 512 && tables[idx][j] == 0) {
+                j++;
+            }
+            printf("    .zero %d\n", (j - i) * 8);
+            i = j;
+        } else {
+            printf("    .quad 0x%016llx    # [%d]\n", (unsigned long long)tables[idx][i], i);
+            i++;
+        }
+    }
+}
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(boot_maps) / sizeof(boot_maps[0]); i++) {
+        if (map(ROOT_KERNEL, &boot_maps[i]) != 0) {
+            fprintf(stderr, "gen_boot_pt: failed to map %s\n", boot_maps[i].name);
+            return 1;
+        }
+    }
+    // 跳板页表：内核页表的根加上恒等映射，下级页表共用
+    memcpy(tables[ROOT_TRAMPOLINE], tables[ROOT_KERNEL], sizeof(tables[0]));
+    if (map(ROOT_TRAMPOLINE, &ident_map) != 0) {
+        fprintf(stderr, "gen_boot_pt: failed to map %s\n", ident_map.name);
+        return 1;
+    }
+
+    printf("# generated by tools/gen_boot_pt.c from inc/memlayout.h, do not edit\n");
+    for (size_t i = 0; i < sizeof(boot_maps) / sizeof(boot_maps[0]); i++) {
+        printf("#   %-8s va=0x%016llx pa=0x%016llx size=0x%llx\n", boot_maps[i].name,
+               (unsigned long long)boot_maps[i].va, (unsigned long long)boot_maps[i].pa,
+               (unsigned long long)boot_maps[i].size);
+    }
+    printf("\n.section .boot_pt, \"aw\"\n");
+    printf(".balign 4096\n");
+    printf(".global boot_page_table\n");
+    printf("boot_page_table:\n");
+    emit_table(ROOT_KERNEL);
+    printf("\n.global boot_trampoline_pt\n");
+    printf("boot_trampoline_pt:\n");
+    for (int i = ROOT_TRAMPOLINE; i < nr_tables; i++) {
+        emit_table(i);
+    }
+
+    // [0..2]=4K/2M/1G叶子数，[3]=页表页数
+    printf("\n.section .rodata\n");
+    printf(".balign 8\n");
+    printf(".global boot_pt_stats\n");
+    printf("boot_pt_stats:\n");
+    printf("    .quad %llu, %llu, %llu, %d\n", (unsigned long long)leaf_count[0],
+           (unsigned long long)leaf_count[1], (unsigned long long)leaf_count[2], nr_tables);
+    return 0;
+}
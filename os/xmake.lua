@@ -12,13 +12,25 @@ target("kernel")
         set_toolchains("riscv64-gcc")
         set_kind("binary")
         set_targetdir("img/")
-        add_includedirs("inc/")
+        add_includedirs("inc/", "../common/")
         add_files("src/*.c")
+        add_files("../common/*.c")
         add_files("src/*.S")
-        add_cflags("-march=rv64imac -mabi=lp64 -mcmodel=medany -fno-builtin -fno-stack-protector -nostdlib -ffreestanding -fno-common -g -Wall -Wextra")
-        add_asflags("-march=rv64imac -mabi=lp64 -mcmodel=medany -fno-builtin -fno-stack-protector -nostdlib -ffreestanding -fno-common -g -Wall -Wextra")
-        add_ldflags("-T kernel.ld -nostdlib -Map img/kernel.map")
+        -- 启动页表在构建时由宿主机工具生成
+        add_files("build/gen/boot_pt.S", {always_added = true})
+        add_cflags("-march=rv64imac -mabi=lp64 -mcmodel=medany -fPIE -fno-builtin -fno-stack-protector -nostdlib -ffreestanding -fno-common -g -Wall -Wextra")
+        add_asflags("-march=rv64imac -mabi=lp64 -mcmodel=medany -fPIE -fno-builtin -fno-stack-protector -nostdlib -ffreestanding -fno-common -g -Wall -Wextra")
+        -- 内核以位置无关方式链接在高地址，启动时自行处理.rela.dyn（见src/reloc.c）
+        add_ldflags("-T kernel.ld -pie --no-dynamic-linker -nostdlib -Map img/kernel.map")
+        before_build(function (target)
+            os.mkdir("build/gen")
+            os.vrunv("cc", {"-O2", "-Wall", "-Wextra", "-Iinc", "-o", "build/gen/gen_boot_pt", "tools/gen_boot_pt.c"})
+            io.writefile("build/gen/boot_pt.S", os.iorunv("build/gen/gen_boot_pt"))
+        end)
         after_build(function (target)
+            -- ELF的段地址都是高地址虚拟地址，QEMU加载从KERNEL_BASE开始的原始镜像
+            os.vrunv("/Volumes/OuterSpace-MBA/Workspace/riscv-learn/tools/riscv64-unknown-elf-toolchain/bin/riscv64-unknown-elf-objcopy",
+                     {"-O", "binary", target:targetfile(), "img/kernel.bin"})
             print("build ok for ")
         end)
     target_end()
@@ -31,10 +43,10 @@ target("run")
             local file = "$(buidir)/$(host)/$(arch)/$(mode)/kernel"
             -- print(file)
             local flags = {
-                "-machine", "virt", "-cpu", "rv64", "-smp", "1",
+                "-machine", "virt", "-cpu", "rv64", "-smp", "4",
                 "-bios", "default", "--no-reboot",
                 "-nographic", "-m","2048M", 
-                "-kernel", "img/kernel"
+                "-kernel", "img/kernel.bin"
             }
             -- flags variable will not  extract the actual value of built-in variables
             -- print(flags)
@@ -49,10 +61,10 @@ target("debug")
         on_run(function (target)
             -- print(file)
             local flags = {
-                "-machine", "virt", "-cpu", "rv64", "-smp", "1",
+                "-machine", "virt", "-cpu", "rv64", "-smp", "4",
                 "-bios", "default", "--no-reboot",
                 "-nographic", "-m","2048M", 
-                "-kernel", "img/kernel", "-s", "-S"
+                "-kernel", "img/kernel.bin", "-s", "-S"
             }
             -- flags variable will not  extract the actual value of built-in variables
             -- print(flags)